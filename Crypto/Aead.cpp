@@ -31,7 +31,10 @@ namespace Crypto
 		// When decrypt, the roles of ciphertext and plaintext are reversed, so the
 		//	ChaCha20 encryption function is applied to the ciphertext, producing the plaintext.
 		//  Note that on decrypt the msg contains ciphertetx
-		cha.encrypt(key, 1, nonce, msg, msg_size, out);
+		// On decrypt the tag is calculated first, so the ciphertext and aad
+		//	may be overwritten by the plaintext (in-place decryption).
+		if (action == Encrypt)
+			cha.encrypt(key, 1, nonce, msg, msg_size, out);
 
 		// Finally, the Poly1305 function is called with the Poly1305 key calculated above, 
 		Poly1305 poly(otk);
@@ -70,5 +73,8 @@ namespace Crypto
 		poly.update((const uint8_t *)&sz, 8);
 
 		poly.finish(tag);
+
+		if (action == Decrypt)
+			cha.encrypt(key, 1, nonce, msg, msg_size, out);
 	}
 }
\ No newline at end of file
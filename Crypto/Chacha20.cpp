@@ -129,6 +129,7 @@ namespace Crypto
 
 			// key_stream is in blk, xor with the message
 			// TODO: XOR by machine words, arbitrary alignment
+			//	keep forward order, out may precede msg in the same buffer (in-place Aead decryption)
 			uint32_t cb = l;
 			uint8_t* k = (uint8_t*)blk;
 			while (cb-- > 0)
@@ -179,6 +179,45 @@ namespace Crypto
 	};
 
 
+	// ChaCha20 random bit generator with fast key erasure
+	//	https://blog.cr.yp.to/20170723-random.html
+	// Each refill runs ChaCha20 with the current key, the first 32 bytes of
+	//	the key stream replace the key, the rest is handed out and erased once used.
+	//	Compromise of the state does not reveal previous output.
+	class Drbg
+	{
+	public:
+		static constexpr unsigned int SEED_SIZE_BYTES = Chacha20::KEY_SIZE_BYTES;		// 32
+		static constexpr unsigned int BUF_SIZE_BYTES = Chacha20::BLK_SIZE_BYTES * 8;	// 512
+
+		Drbg() {}
+
+		Drbg(const uint8_t seed[SEED_SIZE_BYTES])
+		{
+			init(seed);
+		}
+
+		// (re)seed the generator
+		void init(const uint8_t seed[SEED_SIZE_BYTES]);
+
+		// fill data with random bytes
+		//	large requests bypass the buffer, key stream is generated directly into data
+		void generate(uint8_t* data, uint32_t size);
+
+	private:
+		uint8_t _key[SEED_SIZE_BYTES];
+		uint8_t _buf[BUF_SIZE_BYTES];
+		uint32_t _pos = BUF_SIZE_BYTES;		// first unused byte in _buf
+
+		void refill();
+	};
+
+	// fill data with random bytes from the calling thread's generator
+	//	the generator is seeded from system entropy (rnd_seed) on first use
+	//	and reseeded in a child process after fork (rnd_forks)
+	void rnd_data(unsigned char* data, unsigned size);
+
+
 	// Poly1305 is a cryptographic message authentication code (MAC)
 	// Poly1305 takes a 256-bit, one-time key and a message, and it
 	//	produces a 16-byte tag that authenticates the message
@@ -241,6 +280,8 @@ namespace Crypto
 	// The output from the AEAD is twofold:
 	//	-  A ciphertext of the same length as the plaintext.
 	//	-  A 128 - bit tag, which is the output of the Poly1305 function.
+	// Decryption may be done in place: out may be equal to msg or precede it
+	//	in the same buffer, aad may be overwritten too.
 	class Aead
 	{
 	public:
@@ -398,6 +439,26 @@ namespace Crypto
 		uint8_t _pubKey[PUBKEY_SIZE_BYTES];
 	};
 
+	// Runtime selection of implementations (kernels)
+	//	each kernel of a primitive is checked by a known answer test and timed
+	//	by a short benchmark, the fastest correct one is bound.
+	//	A kernel may be forced by override "primitive=kernel[,primitive=kernel...]",
+	//	the SelectEnv environment variable takes precedence over the argument.
+	//	Only MD multiplication and squaring (Karatsuba thresholds) have several kernels,
+	//	Sha512, Chacha20 and Poly1305 have one portable kernel which is self-tested.
+	//	Kernels are process-wide, crypto threads hold them while running.
+	static constexpr const char* SelectEnv = "HAP_CRYPTO";
+
+	// select and bind kernels, returns false if some primitive has no correct kernel
+	//	or when crypto threads are running
+	bool select(const char* over = nullptr);
+
+	// crypto threads hold the bound kernels while running, select is refused until all are released
+	void hold();
+	void release();
+
+	// name of the kernel bound to primitive, nullptr for unknown primitive
+	const char* selected(const char* primitive);
 }
 
 #endif /*_CRYPTO_H_*/
\ No newline at end of file
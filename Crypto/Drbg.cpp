@@ -0,0 +1,94 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "Crypto/Crypto.h"
+
+namespace Crypto
+{
+	static const uint8_t drbg_nonce[Chacha20::NONCE_SIZE_BYTES] = { 0 };
+
+	void Drbg::init(const uint8_t seed[SEED_SIZE_BYTES])
+	{
+		memcpy(_key, seed, SEED_SIZE_BYTES);
+
+		// discard buffered output of the previous seed
+		memset(_buf, 0, sizeof(_buf));
+		_pos = BUF_SIZE_BYTES;
+	}
+
+	// generate next buffer of key stream, replace the key with its first bytes
+	void Drbg::refill()
+	{
+		Chacha20 cha;
+
+		for (unsigned i = 0; i < BUF_SIZE_BYTES / Chacha20::BLK_SIZE_BYTES; i++)
+			cha.block(_key, i, drbg_nonce, _buf + i * Chacha20::BLK_SIZE_BYTES);
+		memset((void*)&cha, 0, sizeof(cha));
+
+		memcpy(_key, _buf, SEED_SIZE_BYTES);
+		memset(_buf, 0, SEED_SIZE_BYTES);
+		_pos = SEED_SIZE_BYTES;
+	}
+
+	void Drbg::generate(uint8_t* data, uint32_t size)
+	{
+		// bulk request - block 0 makes the new key, blocks 1..n go directly to output
+		if (size >= BUF_SIZE_BYTES)
+		{
+			Chacha20 cha;
+			uint8_t blk[Chacha20::BLK_SIZE_BYTES];
+			uint32_t count = 1;
+
+			cha.block(_key, 0, drbg_nonce, blk);
+
+			while (size >= Chacha20::BLK_SIZE_BYTES)
+			{
+				cha.block(_key, count++, drbg_nonce, data);
+				data += Chacha20::BLK_SIZE_BYTES;
+				size -= Chacha20::BLK_SIZE_BYTES;
+			}
+
+			memcpy(_key, blk, SEED_SIZE_BYTES);
+			memset(blk, 0, sizeof(blk));
+			memset((void*)&cha, 0, sizeof(cha));
+		}
+
+		// the rest is served from the buffer, used bytes are erased
+		while (size > 0)
+		{
+			if (_pos == BUF_SIZE_BYTES)
+				refill();
+
+			uint32_t l = BUF_SIZE_BYTES - _pos;
+			if (l > size)
+				l = size;
+
+			memcpy(data, _buf + _pos, l);
+			memset(_buf + _pos, 0, l);
+			_pos += l;
+			data += l;
+			size -= l;
+		}
+	}
+
+	void rnd_data(unsigned char* data, unsigned size)
+	{
+		static thread_local Drbg drbg;
+		static thread_local bool seeded = false;
+		static thread_local unsigned forks = 0;
+
+		if (!seeded || forks != rnd_forks())
+		{
+			uint8_t seed[Drbg::SEED_SIZE_BYTES];
+			rnd_seed(seed, sizeof(seed));
+			drbg.init(seed);
+			memset(seed, 0, sizeof(seed));
+			forks = rnd_forks();
+			seeded = true;
+		}
+
+		drbg.generate(data, size);
+	}
+}
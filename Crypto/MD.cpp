@@ -6,22 +6,35 @@
 #include "Crypto.h"
 #include "MD.h"
 
-static constexpr unsigned D_BITS = 32;				// bits per digit
-static constexpr unsigned D_BYTES = D_BITS / 8;		// bytes per digit
-static constexpr MD::D D_HIBIT = 1UL << (D_BITS - 1);	// highest bit of a digit
-
-uint32_t MD::cntMul;
-uint32_t MD::cntMulS;
-uint32_t MD::cntMulK;
+static constexpr unsigned D_BITS = MD::D_BITS;		// bits per digit
+static constexpr unsigned D_BYTES = MD::D_BYTES;	// bytes per digit
+static constexpr MD::D D_HIBIT = MD::D(1) << (D_BITS - 1);	// highest bit of a digit
+
+thread_local uint32_t MD::cntMul;
+thread_local uint32_t MD::cntMulS;
+thread_local uint32_t MD::cntMulK;
+thread_local uint32_t MD::cntSqr;
+thread_local uint32_t MD::cntSqrK;
+thread_local uint32_t MD::cntMont;
+
+// Karatsuba thresholds, fixed defaults until Crypto::select binds the fastest kernel
+//	on the running machine, md_bench reports the best thresholds of a build
+#if MD_DIGIT_BITS == 64
+std::atomic<uint32_t> MD::karMin{ 32 };
+std::atomic<uint32_t> MD::karSqrMin{ 32 };
+#else
+std::atomic<uint32_t> MD::karMin{ 32 };
+std::atomic<uint32_t> MD::karSqrMin{ 48 };
+#endif
 
 static inline MD::D lowDigit(MD::DD dd)
 {
-	return dd & 0xFFFFFFFF;
+	return (MD::D)dd;
 }
 
 static inline MD::D highDigit(MD::DD dd)
 {
-	return (MD::D)(dd >> 32);
+	return (MD::D)(dd >> D_BITS);
 }
 
 // create MD on provided buffer
@@ -98,9 +111,15 @@ void MD::print() const
 	if (len == 0)
 		len = 1;
 
+#if MD_DIGIT_BITS == 64
+	printf("%llx", (unsigned long long)_d[--len]);
+	while (len--)
+		printf("%016llx", (unsigned long long)_d[len]);
+#else
 	printf("%x", _d[--len]);
 	while (len--)
 		printf("%08x", _d[len]);
+#endif
 }
 #endif
 
@@ -240,13 +259,13 @@ MD::D MD::add(const MD& x, uint32_t n)
 }
 
 // this = x - y (assume x >= y)
-//	returns carry from highest digit (0 or FFFFFFFF)
+//	returns carry from highest digit (0 or all ones)
 MD::D MD::sub(const MD& x, const MD& y)
 {
 	uint32_t m = x.digitLength();	// num of significant digits in x
 	uint32_t n = y.digitLength();	// num of significant digits in y
 
-	D c = 0;   // c is 0 or FFFFFFFF
+	D c = 0;   // c is 0 or all ones
 
 	for (uint32_t i = 0; i < _s; i++)
 	{
@@ -312,9 +331,239 @@ int MD::cmp(const MD& y) const
 	return 0;
 }
 
+// r[0..rn) += a[0..n), n <= rn
+//	returns carry from highest digit (0 or 1)
+static MD::D addDigits(MD::D* r, uint32_t rn, const MD::D* a, uint32_t n)
+{
+	MD::D c = 0;
+	uint32_t i;
+	for (i = 0; i < n; i++)
+	{
+		MD::DD t = (MD::DD)r[i] + a[i] + c;
+		r[i] = lowDigit(t);
+		c = highDigit(t);
+	}
+	for (; c && i < rn; i++)
+	{
+		MD::DD t = (MD::DD)r[i] + c;
+		r[i] = lowDigit(t);
+		c = highDigit(t);
+	}
+	return c;
+}
+
+// r[0..rn) -= a[0..n), n <= rn
+//	returns carry from highest digit (0 or all ones)
+static MD::D subDigits(MD::D* r, uint32_t rn, const MD::D* a, uint32_t n)
+{
+	MD::D c = 0;
+	uint32_t i;
+	for (i = 0; i < n; i++)
+	{
+		MD::DD t = (MD::DD)r[i] - a[i] - (c & 1);
+		r[i] = lowDigit(t);
+		c = highDigit(t);
+	}
+	for (; c && i < rn; i++)
+	{
+		MD::DD t = (MD::DD)r[i] - 1;
+		r[i] = lowDigit(t);
+		c = highDigit(t);
+	}
+	return c;
+}
+
+// r[0..2n) = a[0..n) * b[0..n)
+//	schoolbook multiplication, 14.12 Algorithm Multiple-precision multiplication
+static void mulSchool(MD::D* r, const MD::D* a, const MD::D* b, uint32_t n)
+{
+	memset(r, 0, 2 * n * sizeof(MD::D));
+	for (uint32_t i = 0; i < n; i++)
+	{
+		MD::D c = 0;
+		MD::D bi = b[i];
+		for (uint32_t j = 0; j < n; j++)
+		{
+			MD::DD t = (MD::DD)a[j] * bi + r[i + j] + c;
+			r[i + j] = lowDigit(t);
+			c = highDigit(t);
+		}
+		r[i + n] = c;
+	}
+}
+
+// r[0..2n) = a[0..n)^2
+//	schoolbook squaring, 14.16 Algorithm Multiple-precision squaring
+//	each cross product a_i*a_j (i != j) is calculated once and doubled
+static void sqrSchool(MD::D* r, const MD::D* a, uint32_t n)
+{
+	memset(r, 0, 2 * n * sizeof(MD::D));
+
+	// r = sum of a_i*a_j*b^(i+j), i < j
+	for (uint32_t i = 0; i < n; i++)
+	{
+		MD::D c = 0;
+		MD::D ai = a[i];
+		for (uint32_t j = i + 1; j < n; j++)
+		{
+			MD::DD t = (MD::DD)a[j] * ai + r[i + j] + c;
+			r[i + j] = lowDigit(t);
+			c = highDigit(t);
+		}
+		r[i + n] = c;
+	}
+
+	// r = 2*r + sum of a_i^2*b^(2i)
+	MD::D s = 0;	// bit shifted out of previous digit
+	MD::D c = 0;	// carry from previous digit
+	for (uint32_t i = 0; i < n; i++)
+	{
+		MD::DD sq = (MD::DD)a[i] * a[i];
+		MD::D lo = r[2 * i];
+		MD::D hi = r[2 * i + 1];
+
+		MD::DD t = (MD::DD)((lo << 1) | s) + lowDigit(sq) + c;
+		r[2 * i] = lowDigit(t);
+		c = highDigit(t);
+		s = lo >> (MD::D_BITS - 1);
+
+		t = (MD::DD)((hi << 1) | s) + highDigit(sq) + c;
+		r[2 * i + 1] = lowDigit(t);
+		c = highDigit(t);
+		s = hi >> (MD::D_BITS - 1);
+	}
+}
+
+// Karatsuba multiplication
+//	https://en.wikipedia.org/wiki/Karatsuba_algorithm
+//	a = a1*b^h + a0, b = b1*b^h + b0
+//	z0 = a0*b0
+//	z2 = a1*b1
+//	z1 = (a0+a1)*(b0+b1) - z0 - z2
+//	a*b = z2*b^2h + z1*b^h + z0
+// r[0..2n) = a[0..n) * b[0..n)
+//	operands shorter than km digits are multiplied by schoolbook method
+//	temp storage ws >= karScratch(n, km)
+static void mulKar(MD::D* r, const MD::D* a, const MD::D* b, uint32_t n, MD::D* ws, uint32_t km)
+{
+	if (n < km)
+	{
+		MD::cntMulS++;
+		mulSchool(r, a, b, n);
+		return;
+	}
+	MD::cntMulK++;
+
+	uint32_t h = n / 2;		// digits in a0, b0
+	uint32_t l = n - h;		// digits in a1, b1, l >= h
+
+	// z0 at r[0..2h), z2 at r[2h..2n)
+	mulKar(r, a, b, h, ws, km);
+	mulKar(r + 2 * h, a + h, b + h, l, ws, km);
+
+	// sa = a0+a1, sb = b0+b1, l digits + carry
+	MD::D* sa = ws;
+	MD::D* sb = ws + l;
+	MD::D* z1 = ws + 2 * l;		// 2l+2 digits
+	memset(sa, 0, 2 * l * sizeof(MD::D));
+	memcpy(sa, a, h * sizeof(MD::D));
+	memcpy(sb, b, h * sizeof(MD::D));
+	MD::D ca = addDigits(sa, l, a + h, l);
+	MD::D cb = addDigits(sb, l, b + h, l);
+
+	// z1 = sa*sb
+	mulKar(z1, sa, sb, l, ws + 4 * l + 2, km);
+	z1[2 * l] = 0;
+	z1[2 * l + 1] = 0;
+	if (ca)
+		addDigits(z1 + l, l + 2, sb, l);
+	if (cb)
+		addDigits(z1 + l, l + 2, sa, l);
+	if (ca && cb)
+		addDigits(z1 + 2 * l, 2, &ca, 1);
+
+	// z1 -= z0 + z2
+	subDigits(z1, 2 * l + 2, r, 2 * h);
+	subDigits(z1, 2 * l + 2, r + 2 * h, 2 * l);
+
+	// r += z1*b^h
+	uint32_t zn = 2 * l + 2;
+	if (zn > 2 * n - h)
+		zn = 2 * n - h;
+	addDigits(r + h, 2 * n - h, z1, zn);
+}
+
+// Karatsuba squaring
+//	z1 = (a0+a1)^2 - z0 - z2
+// r[0..2n) = a[0..n)^2
+//	operands shorter than km digits are squared by schoolbook method
+//	temp storage ws >= karScratch(n, km)
+static void sqrKar(MD::D* r, const MD::D* a, uint32_t n, MD::D* ws, uint32_t km)
+{
+	if (n < km)
+	{
+		MD::cntSqr++;
+		sqrSchool(r, a, n);
+		return;
+	}
+	MD::cntSqrK++;
+
+	uint32_t h = n / 2;
+	uint32_t l = n - h;
+
+	sqrKar(r, a, h, ws, km);
+	sqrKar(r + 2 * h, a + h, l, ws, km);
+
+	// sa = a0+a1, l digits + carry
+	MD::D* sa = ws;
+	MD::D* z1 = ws + 2 * l;
+	memset(sa, 0, l * sizeof(MD::D));
+	memcpy(sa, a, h * sizeof(MD::D));
+	MD::D ca = addDigits(sa, l, a + h, l);
+
+	// z1 = sa^2 = sa'^2 + 2*ca*sa'*b^l + ca*b^2l
+	sqrKar(z1, sa, l, ws + 4 * l + 2, km);
+	z1[2 * l] = 0;
+	z1[2 * l + 1] = 0;
+	if (ca)
+	{
+		addDigits(z1 + l, l + 2, sa, l);
+		addDigits(z1 + l, l + 2, sa, l);
+		addDigits(z1 + 2 * l, 2, &ca, 1);
+	}
+
+	subDigits(z1, 2 * l + 2, r, 2 * h);
+	subDigits(z1, 2 * l + 2, r + 2 * h, 2 * l);
+
+	uint32_t zn = 2 * l + 2;
+	if (zn > 2 * n - h)
+		zn = 2 * n - h;
+	addDigits(r + h, 2 * n - h, z1, zn);
+}
+
+// size of temp storage required for Karatsuba multiplication/squaring of n-digit numbers
+//	with threshold km, each recursion level needs 4l+2 digits, l = n - n/2
+static uint32_t karScratch(uint32_t n, uint32_t km)
+{
+	uint32_t s = 0;
+	while (n >= km)
+	{
+		uint32_t l = n - n / 2;
+		s += 4 * l + 2;
+		n = l;
+	}
+	return s;
+}
+
+// size of Karatsuba temp storage at MDCtx::t + 6k + 2
+static inline uint32_t karSize(uint32_t k)
+{
+	return 8 * k + 64;
+}
+
 // this = x * y
 //	INPUT: positive integers x and y having n + 1 and m + 1 base b digits, respectively.
-//	OUTPUT: the product x*y = (w_n+t+1   w_1w_0)b in radix b representation.
+//	OUTPUT: the product x*y = (w_n+t+1   w_1w_0)b in radix b representation.
 //	1. For i from 0 to(n + t + 1) do: w_i = 0.
 //	2. For i from 0 to t do the following :
 //		2.1 c = 0.
@@ -322,31 +571,65 @@ int MD::cmp(const MD& y) const
 //			Compute(uv)b = w_i+j + x_j*y_i + c,
 //			and set w_i+j = v, c = u.
 //		2.3 w_i+n+1 = u.
-bool MD::mul(const MD& x, const MD& y, bool kar)
+// when c is provided and both x and y have at least karMin digits
+//	Karatsuba multiplication is used, the shorter operand is padded with zeros
+bool MD::mul(const MD& x, const MD& y, MDCtx* c)
 {
-#if 0
-	kar = false;
-	if ( kar && (x._s == 96 || y._s == 96))
-	{
-		cntMulK++;
-		return mul_k(x, y);
-	}
-#endif
-	cntMulS++;
+	cntMul++;
 
 	// note that these n and m are greater by 1 that n and m in the algorithm above
 	uint32_t n = x.digitLength();	// num of significant digits in x
 	uint32_t m = y.digitLength();	// num of significant digits in y
 
-	// zero result
-	zero();
-
 	// check if result will fit
 	if (n + m > _s)
+	{
+		zero();
 		return false;
+	}
 
 	if (n == 0 || m == 0)
+	{
+		zero();
 		return true;
+	}
+
+	uint32_t l = n > m ? n : m;		// Karatsuba operand size
+	uint32_t km = karMin.load(std::memory_order_relaxed);
+	if (c != nullptr && n >= km && m >= km && 2 * l <= _s && 2 * l + karScratch(l, km) <= karSize(c->mod.K))
+	{
+		// Karatsuba temp storage at 6k+2
+		//	zero-padded operands 2l digits + karScratch(l, km)
+		D* ws = c->t + 6 * c->mod.K + 2;
+		D* xp = x._d;
+		D* yp = y._d;
+		if (n < l)
+		{
+			memset(ws, 0, l * D_BYTES);
+			memcpy(ws, xp, n * D_BYTES);
+			xp = ws;
+			ws += l;
+		}
+		if (m < l)
+		{
+			memset(ws, 0, l * D_BYTES);
+			memcpy(ws, yp, m * D_BYTES);
+			yp = ws;
+			ws += l;
+		}
+
+		mulKar(_d, xp, yp, l, ws, km);
+
+		if (2 * l < _s)
+			memset(_d + 2 * l, 0, (_s - 2 * l) * D_BYTES);
+
+		return true;
+	}
+
+	cntMulS++;
+
+	// zero result
+	zero();
 
 	D* yp = y._d;
 	D* dp = _d;
@@ -374,98 +657,38 @@ bool MD::mul(const MD& x, const MD& y, bool kar)
 	return true;
 }
 
-#if 0
-// this = x * y
-//	karatsuba multiplication 96d * 96d
-// https://en.wikipedia.org/wiki/Karatsuba_algorithm
-//	temp storage required 66*4 + 64*3 + 33 * 2 digits
-bool MD::mul_k(
-	const MD& x, const MD& y
-)
+// this = x * x
+//	uses Karatsuba squaring when c is provided and x has at least karSqrMin digits
+bool MD::sqr(const MD& x, MDCtx* c)
 {
-	static MDl<32*sizeof(D)> a0, a1, a2, b0, b1, b2;
-	static D p[66 * 4 + 64 * 3 + 33 * 2];
-	D* pp = p;
-
-	memset(p, 0, sizeof(p));
-
-	a0.copy(x,  0, 32);
-	a1.copy(x, 32, 32);
-	a2.copy(x, 64, 32);
-	b0.copy(y,  0, 32);
-	b1.copy(y, 32, 32);
-	b2.copy(y, 64, 32);
-
-	MD p012(pp, 66);	pp += 66;
-	MD p01(pp, 66);		pp += 66;
-	MD p02(pp, 66);		pp += 66;
-	MD p12(pp, 66);		pp += 66;
-	MD p0(pp, 64);		pp += 64;
-	MD p1(pp, 64);		pp += 64;
-	MD p2(pp, 64);		pp += 64;
-	MD t1(pp, 33);		pp += 33;
-	MD t2(pp, 33);		pp += 33;
-
-	// p01 = (a0+a1)(b0+b1)
-	t1.add(a0, a1);
-	t2.add(b0, b1);
-	p01.mul(t1, t2, false);
-
-	// p012 = (a0+a1+p2)(b0+b1+b2)
-	t1.add(a2);
-	t2.add(b2);
-	p012.mul(t1, t2, false);
-
-	// p02 = (a0+a2)(b0+b2)
-	t1.add(a0, a2);
-	t2.add(b0, b2);
-	p02.mul(t1, t2, false);
-
-	// p12 = (a1+a2)(b1+b2)
-	t1.add(a1, a2);
-	t2.add(b1, b2);
-	p12.mul(t1, t2, false);
-
-	// p0 = a0b0
-	p0.mul(a0, b0, false);
-
-	// p1 = a1b1
-	p1.mul(a1, b1, false);
-
-	// p2 = a2b2
-	p2.mul(a2, b2, false);
-
-	// this = 0
-	zero();
-
-	// this += p0 << 0
-	add(p0, 0);
+	uint32_t n = x.digitLength();	// num of significant digits in x
 
-	// this += (p012 + p2 - p02 - p12) << 32
-	add(p012, 32);
-	add(p2, 32);
-	sub(p02, 32);
-	sub(p12, 32);
+	if (2 * n > _s)
+	{
+		zero();
+		return false;
+	}
 
-	// this += (p012 + p1 + p1 - p01 - p12) << 64
-	add(p012, 64);
-	add(p1, 64);
-	add(p1, 64);
-	sub(p01, 64);
-	sub(p12, 64);
+	if (n == 0)
+	{
+		zero();
+		return true;
+	}
 
-	// this += (p012 + p0 - p01 - p02) << 96
-	add(p012, 96);
-	add(p0, 96);
-	sub(p01, 96);
-	sub(p02, 96);
+	uint32_t km = karSqrMin.load(std::memory_order_relaxed);
+	if (c != nullptr && n >= km && karScratch(n, km) <= karSize(c->mod.K))
+		sqrKar(_d, x._d, n, c->t + 6 * c->mod.K + 2, km);
+	else
+	{
+		cntSqr++;
+		sqrSchool(_d, x._d, n);
+	}
 
-	// this += p2 << 128
-	add(p2, 128);
+	if (2 * n < _s)
+		memset(_d + 2 * n, 0, (_s - 2 * n) * D_BYTES);
 
 	return true;
 }
-#endif
 
 // this = v mod N  result: k bits (k - number of bits in N)
 // use Barrett reduction with pre-calculated R
@@ -473,9 +696,14 @@ bool MD::mul_k(
 // if (t > N) t -= N
 // temporary storage >= N.digitLength()*3 + 2
 bool MD::Mod(
+	MDCtx& c,
 	const MD& v						// v: k * 2 bits
 )
 {
+	const MD& N = c.mod.N;
+	uint32_t K = c.mod.K;
+	D* t = c.t;
+
 	if (v.cmp(N) < 0)
 	{
 		copy(v);
@@ -484,7 +712,7 @@ bool MD::Mod(
 
 	// t2 = v*R	size 3k+1 at 1
 	MD t2(t + 1, 3 * K + 1);
-	if (!t2.mul(v, R))
+	if (!t2.mul(v, c.mod.R, &c))
 		return false;
 
 	// t3 = t2 >>= k*2	size k+1 at 1+2*k
@@ -494,7 +722,7 @@ bool MD::Mod(
 
 	// t4 = t3*N	size 2k+1 at 0
 	MD t4(t, 2 * K + 1);
-	if (!t4.mul(t3, N))
+	if (!t4.mul(t3, N, &c))
 		return false;
 
 	// t3 = v-t4	size k+1 at 1+2*k
@@ -512,292 +740,473 @@ bool MD::Mod(
 // this = x+y mod N  result: k bits (k - number of bits in N)
 // temporary storage >= N.digitLength()*5 + 2
 bool MD::addMod(
+	MDCtx& c,
 	const MD& x, const MD& y		// x, y: k bits
 )
 {
+	uint32_t K = c.mod.K;
+
 	// v = x+y  size k+1
-	MD v(t + K * 3 + 2, 2 * K);
+	MD v(c.t + K * 3 + 2, 2 * K);
 	v.add(x, y);
 
-	return Mod(v);
+	return Mod(c, v);
 }
 
 // this = x*y mod N  result: k bits (k - number of bits in N)
 // temporary storage >= N.digitLength()*5 + 2
 bool MD::mulMod(
+	MDCtx& c,
 	const MD& x, const MD& y		// x, y: k bits
 )
 {
+	uint32_t K = c.mod.K;
+
 	// v = x*y  size 2k
-	MD v(t + K * 3 + 2, 2 * K);
-	if (!v.mul(x, y))
+	MD v(c.t + K * 3 + 2, 2 * K);
+	if (!v.mul(x, y, &c))
 		return false;
 
-	return Mod(v);
+	return Mod(c, v);
 }
 
-#if 1
-// this = x^e mod N		result: k bits (k - number of bits in N)
-//	Left-to-right binary exponentiation:
-//	A = 1
-//	for bits in y from leftmost to 0:
-//		A = A*A
-//		if e.bit
-//			A = A*x
-// temporary storage >= N.digitLength()*6 + 2
-bool MD::expMod(
-	const MD& x, const MD& e		// x, y: k bits
+// returns -n^-1 mod b (n must be odd)
+//	Newton iteration x = x*(2 - n*x), each step doubles the number of correct low bits;
+//	the initial x = n is correct to 3 bits since n*n = 1 mod 8 for any odd n
+MD::D MD::negInv(D n)
+{
+	D x = n;
+	for (unsigned i = 3; i < D_BITS; i *= 2)
+		x *= 2 - n * x;
+	return (D)0 - x;
+}
+
+MDMod::MDMod(const MD& N_, const MD& R_, const MD& RR_)
+	: N(N_), R(R_), RR(RR_), N0(MD::negInv(N_._d[0])), K(N_.digitLength())
+{
+}
+
+// this = x*y/b^k mod N  result: k bits (b - digit base, k - number of digits in N)
+//	Montgomery multiplication, Coarsely Integrated Operand Scanning (CIOS) method:
+//	Koc, Acar, Kaliski "Analyzing and Comparing Montgomery Multiplication Algorithms"
+//	T = 0
+//	for i from 0 to k-1:
+//		T = T + x*y_i
+//		m = T_0 * N0 mod b
+//		T = (T + m*N) / b
+//	if T >= N: T = T - N
+// requires x*y < N*b^k, which holds when x < b^k and y < N
+// temporary storage >= N.digitLength()*4 + 2
+bool MD::mulMont(
+	MDCtx& ctx,
+	const MD& x, const MD& y		// x, y: k bits
 )
 {
-	MD A(t + K*5 + 2, K);		// accumulator, up to k bits
-	A.copy(1);
+	const MD& N = ctx.mod.N;
+	const D N0 = ctx.mod.N0;
+	const uint32_t K = ctx.mod.K;
 
-	uint32_t n = e.digitLength();
-	for (uint32_t i = n; i > 0; i--)
-	{
-		D d = e._d[i - 1];
-		D b = D_HIBIT;
+	cntMont++;
 
-		if (i == n)
-			while (!(d & b))
-				b >>= 1;
+	uint32_t n = x.digitLength();	// num of significant digits in x
+	uint32_t m = y.digitLength();	// num of significant digits in y
 
-		while (b > 0)
-		{
-			if (!mulMod(A, A))		// A = A * A mod N - k bits
-				return false;
+	if (n > K || m > K || _s < K)
+		return false;
+
+	// T = 0	size k+2 at 3k
+	D* T = ctx.t + 3 * K;
+	memset(T, 0, (K + 2) * D_BYTES);
+
+	const D* xp = x._d;
+	const D* np = N._d;
 
-			if (d & b)
+	for (uint32_t i = 0; i < K; i++)
+	{
+		D c = 0;
+		DD s;
+
+		// T = T + x*y_i
+		D yi = i < m ? y._d[i] : 0;
+		if (yi != 0)
+		{
+			uint32_t j;
+			for (j = 0; j < n; j++)
 			{
-				if (!A.mulMod(*this, x))	// A = A * x mod N - k bits
-					return false;
+				s = (DD)xp[j] * yi + T[j] + c;
+				T[j] = lowDigit(s);
+				c = highDigit(s);
 			}
-			else
-				A.copy(*this);
+			for (; j < K; j++)
+			{
+				s = (DD)T[j] + c;
+				T[j] = lowDigit(s);
+				c = highDigit(s);
+			}
+		}
+		s = (DD)T[K] + c;
+		T[K] = lowDigit(s);
+		T[K + 1] = highDigit(s);
+
+		// T = (T + m*N) / b
+		D mi = T[0] * N0;
+		s = (DD)mi * np[0] + T[0];
+		c = highDigit(s);
+		for (uint32_t j = 1; j < K; j++)
+		{
+			s = (DD)mi * np[j] + T[j] + c;
+			T[j - 1] = lowDigit(s);
+			c = highDigit(s);
+		}
+		s = (DD)T[K] + c;
+		T[K - 1] = lowDigit(s);
+		T[K] = T[K + 1] + highDigit(s);
+	}
+
+	// this = T > N ? T - N : T
+	MD r(T, K + 1);
+	if (r.cmp(N) >= 0)
+		sub(r, N);
+	else
+		copy(r);
 
-			b >>= 1;
+	return true;
+}
+
+// this = v/b^k mod N  result: k bits
+//	Montgomery reduction, Separated Operand Scanning (SOS) method:
+//	for i from 0 to k-1:
+//		m = v_i * N0 mod b
+//		v = v + m*N*b^i
+//	T = v / b^k
+//	if T >= N: T = T - N
+// requires v < N*b^k
+// temporary storage >= N.digitLength()*5 + 3
+bool MD::redc(
+	MDCtx& ctx,
+	const MD& v						// v: k * 2 bits
+)
+{
+	const MD& N = ctx.mod.N;
+	const D N0 = ctx.mod.N0;
+	const uint32_t K = ctx.mod.K;
+
+	uint32_t n = v.digitLength();	// num of significant digits in v
+
+	if (n > 2 * K || _s < K)
+		return false;
+
+	// T = v	size 2k+1 at 3k, may be same as v
+	D* T = ctx.t + 3 * K;
+	if (T != v._d)
+		memcpy(T, v._d, n * D_BYTES);
+	memset(T + n, 0, (2 * K + 1 - n) * D_BYTES);
+
+	const D* np = N._d;
+
+	for (uint32_t i = 0; i < K; i++)
+	{
+		D mi = T[i] * N0;
+		D c = 0;
+		for (uint32_t j = 0; j < K; j++)
+		{
+			DD s = (DD)mi * np[j] + T[i + j] + c;
+			T[i + j] = lowDigit(s);
+			c = highDigit(s);
+		}
+		for (uint32_t j = i + K; c && j < 2 * K + 1; j++)
+		{
+			DD s = (DD)T[j] + c;
+			T[j] = lowDigit(s);
+			c = highDigit(s);
 		}
-		copy(A);
 	}
 
+	// this = T > N ? T - N : T
+	MD r(T + K, K + 1);
+	if (r.cmp(N) >= 0)
+		sub(r, N);
+	else
+		copy(r);
+
 	return true;
 }
-#endif
 
-#if 0
+// this = x*x/b^k mod N  result: k bits
+//	Montgomery squaring, x is in Montgomery domain
+// temporary storage >= N.digitLength()*5 + 3 + Karatsuba storage
+bool MD::sqrMont(
+	MDCtx& c,
+	const MD& x						// x: k bits
+)
+{
+	uint32_t K = c.mod.K;
+
+	cntMont++;
+
+	// v = x*x	size 2k+1 at 3k
+	MD v(c.t + 3 * K, 2 * K + 1);
+	if (!v.sqr(x, &c))
+		return false;
+
+	return redc(c, v);
+}
+
+// this = x*b^k mod N  - convert x into Montgomery domain
+bool MD::toMont(
+	MDCtx& c,
+	const MD& x						// x: k bits
+)
+{
+	return mulMont(c, x, c.mod.RR);
+}
+
+// this = x/b^k mod N  - convert x out of Montgomery domain
+bool MD::fromMont(
+	MDCtx& c,
+	const MD& x						// x: k bits
+)
+{
+	D one = 1;
+	return mulMont(c, x, MD(&one, 1));
+}
+
+// returns sliding window width for an exponent of given length in bits
+//	the widths minimize number of multiplications (table + window) per exponent
+//	bits  <= 23		w = 1 (binary)
+//	bits  <= 79		w = 3
+//	bits  <= 239	w = 4
+//	bits  <= 671	w = 5	(SRP 256-bit b, 512-bit u and x)
+//	bits  >  671	w = 6
+uint32_t MD::expWindow(uint32_t bits)
+{
+	if (bits > 671)
+		return 6;
+	if (bits > 239)
+		return 5;
+	if (bits > 79)
+		return 4;
+	if (bits > 23)
+		return 3;
+	return 1;
+}
+
+// returns size of expMod workspace (in digits) for an exponent of given length in bits
+//	the workspace holds 2^(w-1) odd powers of x, k digits each
+uint32_t MD::expWorkspace(const MDCtx& c, uint32_t bits)
+{
+	return (1u << (expWindow(bits) - 1)) * c.mod.K;
+}
+
 // this = x^e mod N		result: k bits (k - number of bits in N)
-//	Left-to-right tetrary exponentiation:
-//	A = 1
-//	for bits in y from leftmost to 0:
-//		A = A^4
-//		switch e.(next 2 bits)
-//			case 0:
-//			case 1: A = A*x
-//			case 2: A = A*x^2
-//			case 3: A = A*x^3
-// temporary storage >= N.digitLength()*6 + 2
+//	14.85 Algorithm Sliding-window exponentiation, in Montgomery domain
+//	Precomputation:
+//		X_1 = x*b^k mod N, X_2 = X_1^2
+//		X_2i+1 = X_2i-1 * X_2 for i from 1 to 2^(w-1) - 1
+//	A = 1, i = t (t - index of leftmost bit of e)
+//	while i >= 0:
+//		if e_i == 0:
+//			A = A^2, i = i - 1
+//		else:
+//			find the longest bitstring e_i..e_l such that i-l+1 <= w and e_l = 1
+//			A = A^(2^(i-l+1)) * X_(e_i..e_l)
+//			i = l - 1
+//	this = A/b^k
+// ws - workspace for the odd powers table, expWorkspace(e.bitLength()) digits
+//	when ws is nullptr, internal storage is used (up to ExpMaxWindow)
+//	when ws is too small, window width is reduced to fit
+// temporary storage >= N.digitLength()*14 + 66 + (internal table) N.digitLength()*2^(ExpMaxWindow-1)
 bool MD::expMod(
-	const MD& x, const MD& e		// x, y: k bits
+	MDCtx& c,
+	const MD& x, const MD& e,		// x, y: k bits
+	D* ws, uint32_t ws_len
 )
 {
-	MD A(t + K * 5 + 2, K);		// accumulator, up to k bits
-	A.copy(1);
-
-	static MDl<96 * sizeof(D)> x2;
-	x2.mulMod(x, x);
-	static MDl<96 * sizeof(D)> x3;
-	x3.mulMod(x2, x);
-	static MDl<96 * sizeof(D)> x4;
-	x4.mulMod(x3, x);
-	static MDl<96 * sizeof(D)> x5;
-	x5.mulMod(x4, x);
-	static MDl<96 * sizeof(D)> x6;
-	x6.mulMod(x5, x);
-	static MDl<96 * sizeof(D)> x7;
-	x7.mulMod(x6, x);
-	static MDl<96 * sizeof(D)> x8;
-	x8.mulMod(x7, x);
-	static MDl<96 * sizeof(D)> x9;
-	x9.mulMod(x8, x);
-	static MDl<96 * sizeof(D)> x10;
-	x10.mulMod(x9, x);
-	static MDl<96 * sizeof(D)> x11;
-	x11.mulMod(x10, x);
-	static MDl<96 * sizeof(D)> x12;
-	x12.mulMod(x11, x);
-	static MDl<96 * sizeof(D)> x13;
-	x13.mulMod(x12, x);
-	static MDl<96 * sizeof(D)> x14;
-	x14.mulMod(x13, x);
-	static MDl<96 * sizeof(D)> x15;
-	x15.mulMod(x14, x);
-
-	uint32_t n = e.digitLength();
-	for (uint32_t i = n; i > 0; i--)
-	{
-		D d = e._d[i - 1];
-		D b = D_HIBIT;
-
-		//		if (i == n)
-		//			while (!(d & b))
-		//				b >>= 1;
-
-		while (b > 0)
+	uint32_t K = c.mod.K;
+
+	uint32_t n = e.bitLength();
+	if (n == 0)
+	{
+		copy(1);
+		return true;
+	}
+
+	if (ws == nullptr)
+	{
+		ws = c.t + 14 * K + 66;
+		ws_len = (1u << (ExpMaxWindow - 1)) * K;
+	}
+
+	// window width
+	uint32_t w = expWindow(n);
+	while (w > 1 && ((1u << (w - 1)) * K) > ws_len)
+		w--;
+
+	MD A(c.t + K, K);			// accumulator in Montgomery domain
+
+	// X[j] = x^(2j+1)*b^k mod N
+	MD X0(ws, K);
+	if (!X0.toMont(c, x))
+		return false;
+	if (w > 1)
+	{
+		if (!A.sqrMont(c, X0))		// A = X^2 temporarily
+			return false;
+		for (uint32_t j = 1; j < (1u << (w - 1)); j++)
 		{
-			if (!mulMod(A, A))		// A = A * A mod N - k bits
+			MD Xj(ws + j * K, K);
+			if (!Xj.mulMont(c, MD(ws + (j - 1) * K, K), A))
 				return false;
-			A.copy(*this);
+		}
+	}
 
-			if (!mulMod(A, A))		// A = A * A mod N - k bits
+	bool first = true;
+	int32_t i = n - 1;
+	while (i >= 0)
+	{
+		if (!e.bit(i))
+		{
+			if (!A.sqrMont(c, A))			// A = A * A
 				return false;
-			A.copy(*this);
+			i--;
+			continue;
+		}
 
-			if (!mulMod(A, A))		// A = A * A mod N - k bits
-				return false;
-			A.copy(*this);
+		// find the longest window e_i..e_l with e_l = 1
+		int32_t l = i - w + 1;
+		if (l < 0)
+			l = 0;
+		while (!e.bit(l))
+			l++;
 
-			if (!mulMod(A, A))		// A = A * A mod N - k bits
-				return false;
-			A.copy(*this);
-
-			uint8_t bb = d & b ? 8 : 0;
-			b >>= 1;
-			bb += d & b ? 4 : 0;
-			b >>= 1;
-			bb += d & b ? 2 : 0;
-			b >>= 1;
-			bb += d & b ? 1 : 0;
-			b >>= 1;
-
-			switch(bb)
+		// window value
+		uint32_t v = 0;
+		for (int32_t j = i; j >= l; j--)
+			v = (v << 1) | (uint32_t)e.bit(j);
+
+		MD Xv(ws + (v >> 1) * K, K);
+		if (first)
+		{
+			A.copy(Xv);
+			first = false;
+		}
+		else
+		{
+			for (int32_t j = i; j >= l; j--)
 			{
-			case 0:
-				break;
-			case 1:
-				if (!mulMod(A, x))	// A = A * x mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 2:
-				if (!mulMod(A, x2))	// A = A * x^2 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 3:
-				if (!mulMod(A, x3))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 4:
-				if (!mulMod(A, x4))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 5:
-				if (!mulMod(A, x5))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 6:
-				if (!mulMod(A, x6))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 7:
-				if (!mulMod(A, x7))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 8:
-				if (!mulMod(A, x8))	// A = A * x^3 mod N - k bits
+				if (!A.sqrMont(c, A))		// A = A * A
 					return false;
-				A.copy(*this);
-				break;
-			case 9:
-				if (!mulMod(A, x9))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 10:
-				if (!mulMod(A, x10))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 11:
-				if (!mulMod(A, x11))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 12:
-				if (!mulMod(A, x12))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 13:
-				if (!mulMod(A, x13))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 14:
-				if (!mulMod(A, x14))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
-			case 15:
-				if (!mulMod(A, x15))	// A = A * x^3 mod N - k bits
-					return false;
-				A.copy(*this);
-				break;
 			}
+			if (!A.mulMont(c, A, Xv))		// A = A * X_v
+				return false;
+		}
+
+		i = l - 1;
+	}
+
+	return fromMont(c, A);
+}
+
+// create comb on provided table buffer
+MDComb::MDComb(MD::D* table, uint32_t digits, uint32_t bits, uint32_t h)
+	: _t(table), _s(digits), _bits(bits), _h(h), _a((bits + h - 1) / h)
+{
+}
+
+// precompute the table for base g
+//	T[2^i] = g^(2^(i*a)) for i = 0..h-1
+//	T[j] = T[j - lowbit(j)] * T[lowbit(j)] for other j
+bool MDComb::init(MDCtx& c, const MD& g)
+{
+	uint32_t K = c.mod.K;
+
+	_init = false;
+
+	if (_s < K)
+		return false;
+
+	MD T1(_t + _s, _s);
+	if (!T1.toMont(c, g))
+		return false;
+
+	for (uint32_t i = 1; i < _h; i++)
+	{
+		MD Ti(_t + (1u << i) * _s, _s);
+		Ti.copy(MD(_t + (1u << (i - 1)) * _s, _s));
+		for (uint32_t j = 0; j < _a; j++)
+		{
+			if (!Ti.sqrMont(c, Ti))
+				return false;
 		}
 	}
 
+	for (uint32_t j = 3; j < (1u << _h); j++)
+	{
+		uint32_t lb = j & (0 - j);		// lowest bit of j
+		if (lb == j)
+			continue;
+
+		MD Tj(_t + j * _s, _s);
+		if (!Tj.mulMont(c, MD(_t + (j - lb) * _s, _s), MD(_t + lb * _s, _s)))
+			return false;
+	}
+
+	_init = true;
 	return true;
 }
-#endif
 
-#if 0
-// this = x^e mod N		result: k bits (k - number of bits in N)
-//	A = 1,  S = x
-//	while e != 0
-//		if e is odd
-//			A = A*S
-//		e = e/2
-//		if e != 0
-//			S = S*S
-// temporary storage >= N.digitLength()*6 + 2
-bool MD::expMod(
-	const MD& x, const MD& e		// x, y: k bits
-)
+// r = g^e mod N	result: k bits
+//	A = 1
+//	for k from a-1 down to 0:
+//		A = A^2
+//		I = e_((h-1)a+k)..e_(a+k)e_k
+//		A = A * T[I]
+//	r = A
+bool MDComb::exp(MDCtx& c, MD& r, const MD& e) const
 {
-	MD A(t + K * 5 + 2, K);		// accumulator, up to k bits
-	A.copy(1);
+	if (!_init)
+		return false;
 
-	static MDl<96* sizeof(D)> S;
-	S.copy(x);
+	uint32_t n = e.bitLength();
+	if (n > _bits)
+		return false;
 
-	uint32_t n = e.digitLength();
-	for (uint32_t i = 0; i < n; i++)
+	MD A(c.t + c.mod.K, c.mod.K);		// accumulator in Montgomery domain
+	bool first = true;
+
+	for (uint32_t k = _a; k > 0; k--)
 	{
-		D d = e._d[i];
+		if (!first)
+		{
+			if (!A.sqrMont(c, A))		// A = A * A
+				return false;
+		}
 
-		for (uint8_t b = 0; b < sizeof(D) * 8; b++)
+		uint32_t I = 0;
+		for (uint32_t i = _h; i > 0; i--)
 		{
-			if (d & 1)
-			{
-				mulMod(A, S);
-				A.copy(*this);
-			}
+			uint32_t b = (i - 1) * _a + k - 1;
+			I = (I << 1) | (b < n ? (uint32_t)e.bit(b) : 0);
+		}
 
-			d >>= 1;
+		if (I == 0)
+			continue;
 
-			mulMod(S, S);
-			S.copy(*this);
+		MD TI(_t + I * _s, _s);
+		if (first)
+		{
+			A.copy(TI);
+			first = false;
 		}
+		else if (!A.mulMont(c, A, TI))	// A = A * T[I]
+			return false;
+	}
 
-		copy(A);
+	if (first)
+	{
+		r.copy(1);
+		return true;
 	}
 
-	return true;
+	return r.fromMont(c, A);
 }
-#endif
\ No newline at end of file
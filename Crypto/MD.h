@@ -6,22 +6,56 @@
 #ifndef _CRYPTO_BD_H_
 #define _CRYPTO_BD_H_
 
+#include <atomic>
+
 // Subset of bignum math required for HAP
 //	Based on algorithms from Handbook of Applied
 //	Cryptography http://cacr.uwaterloo.ca/hac/
 
+// Digit size
+//	MD_DIGIT_BITS=64 - 64-bit digits, requires unsigned __int128 (GCC/Clang on 64-bit targets)
+//	MD_DIGIT_BITS=32 - 32-bit digits, portable
+//	when not defined, the widest supported digit is selected
+#if !defined(MD_DIGIT_BITS)
+#if defined(__SIZEOF_INT128__)
+#define MD_DIGIT_BITS 64
+#else
+#define MD_DIGIT_BITS 32
+#endif
+#endif
+
+class MDCtx;
+
 // Multi-digit integer
+//	modular operations take MDCtx which provides the modulus and temp storage
 class MD
 {
 public:
+#if MD_DIGIT_BITS == 64
+	using D = uint64_t;			// base digit - 64 bit machine word
+	using DD = unsigned __int128;	// double digit
+#elif MD_DIGIT_BITS == 32
 	using D = uint32_t;			// base digit - 32 bit machine word
 	using DD = uint64_t;		// double digit
-	static constexpr unsigned D_BITS = 32;				// bits per digit
+#else
+#error "MD_DIGIT_BITS must be 32 or 64"
+#endif
+	static constexpr unsigned D_BITS = MD_DIGIT_BITS;	// bits per digit
 	static constexpr unsigned D_BYTES = D_BITS / 8;		// bytes per digit
 
-	static uint32_t cntMul;
-	static uint32_t cntMulS;
-	static uint32_t cntMulK;
+	// operation counters, per thread
+	static thread_local uint32_t cntMul;	// mul calls
+	static thread_local uint32_t cntMulS;	// schoolbook multiplications
+	static thread_local uint32_t cntMulK;	// Karatsuba multiplication steps
+	static thread_local uint32_t cntSqr;	// schoolbook squarings
+	static thread_local uint32_t cntSqrK;	// Karatsuba squaring steps
+	static thread_local uint32_t cntMont;	// Montgomery products and squares
+
+	// Karatsuba thresholds - min number of digits in operands
+	//	shorter operands are multiplied/squared using schoolbook method
+	//	read once per mul/sqr call, so a change never splits one operation
+	static std::atomic<uint32_t> karMin;
+	static std::atomic<uint32_t> karSqrMin;
 
 	// create MD on provided buffer
 	MD(D* d, uint32_t digits);
@@ -78,51 +112,107 @@ public:
 	D add(const MD& x, uint32_t n = 0);
 
 	// this = x - y (assume x >= y)
-	//	returns carry from highest digit (0 or FFFFFFFF)
+	//	returns carry from highest digit (0 or all ones)
 	D sub(const MD& x, const MD& y);
 
 	// this -= (x << n)
-	//	returns carry from highest digit (0 or FFFFFFFF)
+	//	returns carry from highest digit (0 or all ones)
 	D sub(const MD& x, uint32_t n = 0);
 
 	// returns sign of this-y (1, 0, -1)
 	int cmp(const MD& y) const;
 
 	// this = x * y
-	bool mul(const MD& x, const MD& y, bool kar = true);
+	//	Karatsuba multiplication uses temp storage of c, schoolbook method is used without c
+	bool mul(const MD& x, const MD& y, MDCtx* c = nullptr);
 
-	// this = x * y
-	//	this - >= 192D, x, y <= 96D 
-	//bool mul_k(const MD& x, const MD& y);
+	// this = x * x
+	bool sqr(const MD& x, MDCtx* c = nullptr);
 
 	// this = v mod N  result: k bits (k - number of bits in N)
 	// use Barrett reduction with pre-calculated R
 	bool Mod(
+		MDCtx& c,
 		const MD& v					// v: k * 2 bits
 	);
 
 	// this = x+y mod N  result: k bits (k - number of bits in N)
 	bool addMod(
+		MDCtx& c,
 		const MD& x, const MD& y	// x, y: k bits
 	);
 
 	// this = x*y mod N  result: k bits (k - number of bits in N)
 	bool mulMod(
+		MDCtx& c,
+		const MD& x, const MD& y	// x, y: k bits
+	);
+
+	// this = x*y/b^k mod N  result: k bits (b - digit base, k - number of digits in N)
+	// Montgomery product, x and y are in Montgomery domain
+	bool mulMont(
+		MDCtx& c,
 		const MD& x, const MD& y	// x, y: k bits
 	);
 
+	// this = x*x/b^k mod N  result: k bits
+	// Montgomery square, x is in Montgomery domain
+	bool sqrMont(
+		MDCtx& c,
+		const MD& x					// x: k bits
+	);
+
+	// this = v/b^k mod N  result: k bits
+	// Montgomery reduction
+	bool redc(
+		MDCtx& c,
+		const MD& v					// v: k * 2 bits
+	);
+
+	// this = x*b^k mod N  - convert x into Montgomery domain
+	bool toMont(
+		MDCtx& c,
+		const MD& x					// x: k bits
+	);
+
+	// this = x/b^k mod N  - convert x out of Montgomery domain
+	bool fromMont(
+		MDCtx& c,
+		const MD& x					// x: k bits
+	);
+
+	// max sliding window width when expMod uses internal workspace
+	static constexpr uint32_t ExpMaxWindow = 5;
+
+	// returns sliding window width for an exponent of given length in bits
+	static uint32_t expWindow(uint32_t bits);
+
+	// returns size of expMod workspace (in digits) for an exponent of given length in bits
+	static uint32_t expWorkspace(const MDCtx& c, uint32_t bits);
+
 	// this = x^e mod N		result: k bits (k - number of bits in N)
+	//	ws - optional workspace for precomputed powers of x, ws_len - its size in digits
 	bool expMod(
-		const MD& x, const MD& e	// x, y: k bits
+		MDCtx& c,
+		const MD& x, const MD& e,	// x, y: k bits
+		D* ws = nullptr, uint32_t ws_len = 0
 	);
 
+	// returns -n^-1 mod b (n must be odd)
+	static D negInv(D n);
+
 private:
+	friend class MDMod;
+	friend class MDComb;
+
 	D* _d;				// external storage for digits
 	uint32_t _s;		// max size in digits
-	static MD N;
-	static MD R;
-	static uint32_t K;	// number of digits in N
-	static D* t;		// min size [N_DIGITS * 6 + 2];
+
+	// returns bit i of the number
+	D bit(uint32_t i) const
+	{
+		return (_d[i / D_BITS] >> (i % D_BITS)) & 1;
+	}
 };
 
 // MDl - the storage is allocated in the object itself
@@ -138,6 +228,88 @@ public:
 };
 
 
+// Modulus N and precalculated reduction constants
+//	read-only after creation, may be shared by contexts running in parallel
+class MDMod
+{
+public:
+	MDMod(
+		const MD& N_,	// modulus, must be odd
+		const MD& R_,	// Barrett constant b^(2k)/N
+		const MD& RR_	// Montgomery constant b^(2k) mod N
+	);
+
+	const MD N;
+	const MD R;
+	const MD RR;
+	const MD::D N0;		// Montgomery constant -N^-1 mod b
+	const uint32_t K;	// number of digits in N
+};
+
+// Modular arithmetic context - modulus and temp storage
+//	temp storage min size [k * 30 + 66] digits (k - number of digits in N)
+//	operations running in parallel must use separate contexts
+class MDCtx
+{
+public:
+	MDCtx(const MDMod& mod_, MD::D* t_)
+		: mod(mod_), t(t_)
+	{}
+
+	const MDMod& mod;
+	MD::D* const t;
+};
+
+// MDCtxl - the temp storage is allocated in the object itself
+template <uint32_t S>		// S - size of N in bytes
+class MDCtxl : public MDCtx
+{
+private:
+	static constexpr uint32_t Sd = S / MD::D_BYTES + ((S % MD::D_BYTES) ? 1 : 0);	// size in digits
+	MD::D _t[Sd * 30 + 66];
+public:
+	MDCtxl(const MDMod& mod_) : MDCtx(mod_, _t) {}
+};
+
+// Fixed-base comb exponentiation
+//	14.117 Algorithm Fixed-base comb method for exponentiation
+//	the table holds 2^h products of g^(2^(i*a)), i = 0..h-1, a = ceil(bits/h),
+//	in Montgomery domain; g^e then takes a squarings and a multiplications
+class MDComb
+{
+public:
+	// create comb on provided table buffer
+	//	table - 2^h entries, digits each (digits >= number of digits in N)
+	//	bits - max length of exponent
+	//	h - number of comb rows
+	MDComb(MD::D* table, uint32_t digits, uint32_t bits, uint32_t h);
+
+	// precompute the table for base g
+	bool init(MDCtx& c, const MD& g);
+
+	// r = g^e mod N	result: k bits
+	//	fails if e is longer than bits
+	bool exp(MDCtx& c, MD& r, const MD& e) const;
+
+private:
+	MD::D* _t;			// table
+	uint32_t _s;		// table entry size in digits
+	uint32_t _bits;		// max exponent length
+	uint32_t _h;		// number of rows
+	uint32_t _a;		// number of columns
+	bool _init = false;
+};
+
+// MDCombl - the table is allocated in the object itself
+template <uint32_t S, uint32_t Bits, uint32_t H = 6>	// S - size of N in bytes, Bits - max exponent length
+class MDCombl : public MDComb
+{
+private:
+	static constexpr uint32_t Sd = S / MD::D_BYTES + ((S % MD::D_BYTES) ? 1 : 0);	// size in digits
+	MD::D _tbl[(1 << H) * Sd];
+public:
+	MDCombl() : MDComb(_tbl, Sd, Bits, H) {}
+};
 
 #endif /*_CRYPTO_BD_H_*/
 
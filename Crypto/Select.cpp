@@ -0,0 +1,356 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "Crypto/Crypto.h"
+#include "Crypto/MD.h"
+#include "Crypto/Srp.h"
+
+namespace Crypto
+{
+	namespace _Select
+	{
+		// selection context - calculation context and SRP size operands for MD kernels
+		struct Ctx
+		{
+			Srp::Ctx srp;
+			MDl<Srp::SRP_MODULO_BYTES> a, b;
+			MDl<Srp::SRP_MODULO_BYTES * 2> r, s;
+		};
+
+		// kernel - one implementation of a primitive
+		struct Kernel
+		{
+			const char* name;
+			void (*bind)();			// make this kernel current, nullptr if primitive has one kernel
+		};
+
+		// primitive - set of kernels, known answer test and benchmark
+		//	test and bench run on currently bound kernel
+		struct Primitive
+		{
+			const char* name;
+			const Kernel* kernel;
+			unsigned count;
+			bool (*test)(Ctx& c);
+			void (*bench)(Ctx& c);		// nullptr if primitive has one kernel
+			unsigned cur;			// index of bound kernel, count - built-in default
+		};
+
+		// MD multiplication - schoolbook or Karatsuba above threshold (digits)
+		static const Kernel mul[] =
+		{
+			{ "school", []() { MD::karMin = 0xFFFFFFFF; } },
+			{ "kar16", []() { MD::karMin = 16; } },
+			{ "kar24", []() { MD::karMin = 24; } },
+			{ "kar32", []() { MD::karMin = 32; } },
+			{ "kar40", []() { MD::karMin = 40; } },
+			{ "kar48", []() { MD::karMin = 48; } },
+		};
+
+		static bool mulTest(Ctx& c)
+		{
+			c.a.random();
+			c.b.random();
+			c.r.mul(c.a, c.b, &c.srp.md);
+			c.s.mul(c.a, c.b);				// schoolbook reference
+			return c.r.cmp(c.s) == 0;
+		}
+
+		static void mulBench(Ctx& c)
+		{
+			c.r.mul(c.a, c.b, &c.srp.md);
+		}
+
+		// MD squaring - schoolbook or Karatsuba above threshold (digits)
+		static const Kernel sqr[] =
+		{
+			{ "school", []() { MD::karSqrMin = 0xFFFFFFFF; } },
+			{ "kar16", []() { MD::karSqrMin = 16; } },
+			{ "kar24", []() { MD::karSqrMin = 24; } },
+			{ "kar32", []() { MD::karSqrMin = 32; } },
+			{ "kar40", []() { MD::karSqrMin = 40; } },
+			{ "kar48", []() { MD::karSqrMin = 48; } },
+		};
+
+		static bool sqrTest(Ctx& c)
+		{
+			c.a.random();
+			c.r.sqr(c.a, &c.srp.md);
+			c.s.mul(c.a, c.a);				// schoolbook reference
+			return c.r.cmp(c.s) == 0;
+		}
+
+		static void sqrBench(Ctx& c)
+		{
+			c.r.sqr(c.a, &c.srp.md);
+		}
+
+		// portable kernels of symmetric primitives, checked against RFC vectors
+		//	the only kernel is self-tested, a benchmark comes with a second kernel
+		static const Kernel ref[] =
+		{
+			{ "ref", nullptr },
+		};
+
+		static bool sha512Test(Ctx& c)
+		{
+			static const uint8_t v[Sha512::HASH_SIZE_BYTES] =
+			{
+				0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+				0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+				0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+				0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f
+			};
+
+			c.srp.sha.calc((const uint8_t*)"abc", 3, c.srp.hash);
+			return memcmp(c.srp.hash, v, sizeof(v)) == 0;
+		}
+
+		static const uint8_t chaKey[Chacha20::KEY_SIZE_BYTES] =
+		{
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+			0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+		};
+		static const uint8_t chaNonce[Chacha20::NONCE_SIZE_BYTES] =
+		{
+			0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00
+		};
+
+		static bool chacha20Test(Ctx&)
+		{
+			static const uint8_t v[Chacha20::BLK_SIZE_BYTES] =
+			{
+				0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+				0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+				0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+				0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+			};
+
+			uint8_t b[Chacha20::BLK_SIZE_BYTES];
+			Chacha20 cha;
+			cha.block(chaKey, 1, chaNonce, b);
+			return memcmp(b, v, sizeof(v)) == 0;
+		}
+
+		static const uint8_t polyKey[Poly1305::KEY_SIZE_BYTES] =
+		{
+			0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33, 0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+			0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd, 0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b
+		};
+
+		static bool poly1305Test(Ctx&)
+		{
+			static const char msg[] = "Cryptographic Forum Research Group";
+			static const uint8_t v[Poly1305::TAG_SIZE_BYTES] =
+			{
+				0xa8, 0x06, 0x1d, 0xc1, 0x30, 0x51, 0x36, 0xc6, 0xc2, 0x2b, 0x8b, 0xaf, 0x0c, 0x01, 0x27, 0xa9
+			};
+
+			uint8_t t[Poly1305::TAG_SIZE_BYTES];
+			Poly1305 p(polyKey, (const uint8_t*)msg, sizeof(msg) - 1, t);
+			return memcmp(t, v, sizeof(v)) == 0;
+		}
+
+		static Primitive prim[] =
+		{
+			{ "mul", mul, sizeofarr(mul), mulTest, mulBench, sizeofarr(mul) },
+			{ "sqr", sqr, sizeofarr(sqr), sqrTest, sqrBench, sizeofarr(sqr) },
+			{ "sha512", ref, sizeofarr(ref), sha512Test, nullptr, 0 },
+			{ "chacha20", ref, sizeofarr(ref), chacha20Test, nullptr, 0 },
+			{ "poly1305", ref, sizeofarr(ref), poly1305Test, nullptr, 0 },
+		};
+
+		static void bind(Primitive& p, unsigned k)
+		{
+			if (k >= p.count)
+				return;
+			if (p.kernel[k].bind != nullptr)
+				p.kernel[k].bind();
+			p.cur = k;
+		}
+
+		// benchmark of bound kernel, best of several rounds in ns per operation
+		static uint64_t bench(Primitive& p, Ctx& c)
+		{
+			static constexpr int Rounds = 3;
+			static constexpr int Ops = 64;
+			uint64_t best = 0;
+
+			for (int r = 0; r < Rounds; r++)
+			{
+				Timer::Point t1 = Timer::now();
+				for (int i = 0; i < Ops; i++)
+					p.bench(c);
+				Timer::Point t2 = Timer::now();
+
+				uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / Ops;
+				if (r == 0 || ns < best)
+					best = ns;
+			}
+
+			return best;
+		}
+
+		// find kernel requested for primitive p in override list "prim=kernel[,prim=kernel...]"
+		//	returns kernel index or -1
+		static int find(const Primitive& p, const char* over)
+		{
+			if (over == nullptr)
+				return -1;
+
+			size_t pl = strlen(p.name);
+			const char* s = over;
+			while (*s != 0)
+			{
+				const char* e = strchr(s, ',');
+				size_t l = e != nullptr ? size_t(e - s) : strlen(s);
+
+				if (l > pl && s[pl] == '=' && strncmp(s, p.name, pl) == 0)
+				{
+					const char* k = s + pl + 1;
+					size_t kl = l - pl - 1;
+					for (unsigned i = 0; i < p.count; i++)
+					{
+						if (strlen(p.kernel[i].name) == kl && strncmp(k, p.kernel[i].name, kl) == 0)
+							return int(i);
+					}
+
+					LOG_MSG("Crypto: unknown %s kernel '%.*s'\n", p.name, int(kl), k);
+					return -1;
+				}
+
+				s += l;
+				if (*s == ',')
+					s++;
+			}
+
+			return -1;
+		}
+
+		// number of running crypto threads
+		static std::atomic<unsigned> holders{ 0 };
+	}
+
+	void hold()
+	{
+		_Select::holders++;
+	}
+
+	void release()
+	{
+		_Select::holders--;
+	}
+
+	bool select(const char* over)
+	{
+		using namespace _Select;
+
+		// rebinding would change kernels under running calculations
+		if (holders != 0)
+		{
+			LOG_MSG("Crypto: select refused, crypto threads are running\n");
+			return false;
+		}
+
+		// environment takes precedence over configuration
+		const char* env = getenv(SelectEnv);
+		if (env != nullptr && *env != 0)
+			over = env;
+
+		if (over != nullptr && *over != 0)
+			LOG_MSG("Crypto: select override '%s'\n", over);
+
+		// the context is large, allocate it only for the time of selection
+		Ctx* c = new Ctx;
+		bool ret = true;
+
+		for (unsigned i = 0; i < sizeofarr(prim); i++)
+		{
+			Primitive& p = prim[i];
+			unsigned prev = p.cur;
+			int best = -1;
+			uint64_t bestNs = 0;
+			bool forced = false;
+
+			// requested kernel is used if it passes the test
+			int k = find(p, over);
+			if (k >= 0)
+			{
+				bind(p, k);
+				if (p.test(*c))
+				{
+					best = k;
+					forced = true;
+				}
+				else
+					LOG_MSG("Crypto: %s kernel %s failed self-test\n", p.name, p.kernel[k].name);
+			}
+
+			for (unsigned j = 0; !forced && j < p.count; j++)
+			{
+				bind(p, j);
+				if (!p.test(*c))
+				{
+					LOG_MSG("Crypto: %s kernel %s failed self-test\n", p.name, p.kernel[j].name);
+					continue;
+				}
+
+				// the only kernel needs no benchmark
+				if (p.count == 1 || p.bench == nullptr)
+				{
+					best = j;
+					break;
+				}
+
+				uint64_t ns = bench(p, *c);
+				Log::Dbg("Crypto: %s kernel %s %llu ns\n", p.name, p.kernel[j].name, (unsigned long long)ns);
+				if (best < 0 || ns < bestNs)
+				{
+					best = j;
+					bestNs = ns;
+				}
+			}
+
+			// the benchmark leaves the last kernel bound
+			if (best >= 0)
+			{
+				bind(p, best);
+				if (forced)
+					LOG_MSG("Crypto: %s = %s (override)\n", p.name, p.kernel[best].name);
+				else if (bestNs != 0)
+					LOG_MSG("Crypto: %s = %s (%llu ns)\n", p.name, p.kernel[best].name, (unsigned long long)bestNs);
+				else
+					LOG_MSG("Crypto: %s = %s\n", p.name, p.kernel[best].name);
+			}
+			else
+			{
+				bind(p, prev);		// keep previous choice or built-in default
+				p.cur = prev;
+				LOG_MSG("Crypto: %s has no correct kernel\n", p.name);
+				ret = false;
+			}
+		}
+
+		delete c;
+
+		return ret;
+	}
+
+	const char* selected(const char* primitive)
+	{
+		using namespace _Select;
+
+		for (unsigned i = 0; i < sizeofarr(prim); i++)
+		{
+			if (strcmp(prim[i].name, primitive) == 0)
+			{
+				const Primitive& p = prim[i];
+				return p.cur < p.count ? p.kernel[p.cur].name : "default";
+			}
+		}
+
+		return nullptr;
+	}
+}
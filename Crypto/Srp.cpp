@@ -7,6 +7,8 @@
 #include "Crypto/MD.h"
 #include "Crypto/Srp.h"
 #include <string.h>
+#include <atomic>
+#include <mutex>
 
 static const uint8_t N_val[] =
 {
@@ -37,8 +39,7 @@ static const uint8_t N_val[] =
 };
 static constexpr uint32_t N_DIGITS = sizeof(N_val) / sizeof(MD::D);
 static MD::D N_buf[N_DIGITS];
-MD MD::N(N_buf, N_val, sizeof(N_val));
-uint32_t MD::K = N_DIGITS;
+static const MD N(N_buf, N_val, sizeof(N_val));
 
 static uint8_t R_val[] =
 {
@@ -69,33 +70,95 @@ static uint8_t R_val[] =
 	0x52, 0x94, 0xF5, 0xE1, 0x27, 0x0E, 0x48, 0xC7, 0x26, 0x97, 0xCA, 0x91, 0x38, 0xD2, 0x41, 0xCD,
 };
 static MD::D R_buf[N_DIGITS + 1];
-MD MD::R(R_buf, R_val, sizeof(R_val));
+static const MD R(R_buf, R_val, sizeof(R_val));
 
-// temp bufer for both SRP and MD
-static MD::D tmp[N_DIGITS * 6 + 2];
-static uint8_t* t = reinterpret_cast<uint8_t*>(tmp);
-MD::D* MD::t = tmp;
+// Montgomery constants
+//	RR = 2^(2*3072) mod N, same value for 32 and 64 bit digits
+static const uint8_t RR_val[] =
+{
+	0x5A, 0xC8, 0xB4, 0xFB, 0x51, 0xDF, 0x35, 0xDA,	0x44, 0xC4, 0xE4, 0xE4, 0x31, 0xAD, 0x02, 0x95,
+	0xA3, 0x32, 0xE8, 0xE3, 0xE0, 0x66, 0x9E, 0x0F,	0x84, 0x89, 0x5A, 0x7C, 0x55, 0x42, 0xF9, 0x6C,
+	0x2A, 0xD4, 0x79, 0xFE, 0x69, 0x69, 0x5C, 0x75,	0xFA, 0xE1, 0xCD, 0x10, 0x64, 0x8B, 0xEE, 0x54,
+	0xFA, 0x02, 0x23, 0x36, 0xF2, 0x8D, 0xE7, 0x72,	0x5C, 0xAA, 0x69, 0x00, 0x9F, 0xBF, 0x54, 0x3F,
+	0x98, 0x75, 0xD4, 0xC1, 0x67, 0xDB, 0x7E, 0xDC,	0xAA, 0x05, 0xDA, 0x05, 0xC2, 0x7F, 0xDD, 0x33,
+	0xAF, 0x0E, 0xC4, 0x5C, 0xDC, 0x39, 0x60, 0x86,	0x22, 0x76, 0xCB, 0x40, 0x57, 0x1F, 0x2C, 0x1C,
+	0x49, 0xCD, 0x9D, 0x70, 0x5D, 0xA1, 0x84, 0xD5,	0x71, 0x39, 0xD0, 0xAB, 0x24, 0xB7, 0xE4, 0x95,
+	0xA5, 0xDA, 0xF7, 0x36, 0xBC, 0x8D, 0x5E, 0x9E,	0x10, 0x9D, 0x09, 0x9E, 0x16, 0xFD, 0x75, 0x68,
+	0x77, 0xA5, 0xC7, 0x47, 0xD8, 0x5B, 0x0A, 0x83,	0x8C, 0x6C, 0xBD, 0x34, 0xD5, 0x96, 0x51, 0x34,
+	0xA7, 0x3D, 0x01, 0x03, 0x2C, 0x4B, 0x8E, 0x90,	0x7D, 0xED, 0x48, 0x9E, 0x67, 0x0D, 0x9C, 0x6F,
+	0x19, 0xC2, 0x88, 0x3E, 0xEF, 0xC8, 0x02, 0xAF,	0x06, 0x72, 0xA3, 0x3D, 0x61, 0xE3, 0x7F, 0x74,
+	0x7C, 0xDA, 0x50, 0x2E, 0xC0, 0x43, 0xF9, 0x9C,	0x9A, 0x67, 0x8B, 0xF4, 0x43, 0x9F, 0x12, 0xEB,
+	0x5A, 0x77, 0x95, 0xD8, 0x6E, 0xCC, 0x49, 0x87,	0x19, 0xCC, 0x8D, 0x59, 0x56, 0x37, 0x06, 0xFB,
+	0xB4, 0x1A, 0x05, 0xF0, 0x78, 0x02, 0x42, 0x08,	0xBF, 0xD9, 0x61, 0xD5, 0x38, 0xD6, 0xFC, 0xDD,
+	0x4F, 0x12, 0x76, 0x82, 0x56, 0xE8, 0x8B, 0x53,	0x78, 0x54, 0x83, 0xC6, 0x08, 0x10, 0x8C, 0x0C,
+	0x3E, 0xFE, 0xF2, 0x9D, 0xC3, 0xC0, 0xB3, 0xF4,	0x1B, 0x9D, 0x01, 0x27, 0x1D, 0x18, 0xF0, 0xC8,
+	0x1C, 0xAE, 0xFC, 0x18, 0x8A, 0x59, 0xBC, 0x7F,	0xB1, 0x86, 0x42, 0x4B, 0x83, 0xDF, 0x28, 0x59,
+	0xAF, 0x80, 0xD4, 0xB5, 0x44, 0x35, 0x61, 0xC6,	0xFE, 0xA5, 0x18, 0x7F, 0xA7, 0x7D, 0xED, 0xDA,
+	0x1D, 0x93, 0x07, 0x5A, 0xA9, 0x93, 0xD1, 0x47,	0x1E, 0xF2, 0x25, 0x71, 0xE4, 0x1A, 0x52, 0xB2,
+	0x8A, 0xA6, 0x13, 0x91, 0xAB, 0xB0, 0xB7, 0x6A,	0xBC, 0x2B, 0x64, 0xCF, 0x26, 0xE3, 0x35, 0xD7,
+	0x68, 0x2A, 0xAB, 0x9A, 0x15, 0xB1, 0x7F, 0xFA,	0xFC, 0x11, 0x87, 0xA5, 0xFA, 0x84, 0x06, 0xAB,
+	0xAE, 0x12, 0x84, 0x02, 0x3C, 0x6E, 0xD6, 0xA3,	0x43, 0x35, 0xAA, 0xCB, 0x64, 0x89, 0x4D, 0x96,
+	0x95, 0x82, 0x32, 0x15, 0xB1, 0x5B, 0xA5, 0x77,	0x4F, 0x30, 0xB9, 0x20, 0xE5, 0xC1, 0xDB, 0x66,
+	0x35, 0x87, 0xF0, 0x69, 0x60, 0xE7, 0xF1, 0x38,	0x26, 0x97, 0xCA, 0x91, 0x38, 0xD2, 0x41, 0xCD,
+};
+static MD::D RR_buf[N_DIGITS];
+static const MD RR(RR_buf, RR_val, sizeof(RR_val));
+
+// SRP modulus, shared by all contexts
+static const MDMod N_mod(N, R, RR);
 
 namespace Srp
 {
 	static const uint8_t g_val[] = { 0x05 };
 	const MDl<sizeof(g_val)> g(g_val);
 
-	// shared temp data
-	MDl<SRP_MODULO_BYTES> t1, t2, t3, t4;
-	Crypto::Sha512 sha;
-	static uint8_t hash[Crypto::Sha512::HASH_SIZE_BYTES];
+	Ctx::Ctx()
+		: md(N_mod)
+	{
+	}
+
+	// fixed-base comb table for g, exponents up to hash size (x, a, b)
+	//	built on first use, read-only after that
+	static MDCombl<SRP_MODULO_BYTES, Crypto::Sha512::HASH_SIZE_BYTES * 8> gComb;
+	static std::atomic<bool> gReady{ false };
+	static std::mutex gMtx;
+
+	// returns g comb table, or nullptr if it cannot be built (next call tries again)
+	static const MDComb* gc(Ctx& c)
+	{
+		if (gReady.load(std::memory_order_acquire))
+			return &gComb;
+
+		std::unique_lock<std::mutex> lock(gMtx);
+		if (!gReady.load(std::memory_order_relaxed))
+		{
+			if (!gComb.init(c.md, g))
+				return nullptr;
+			gReady.store(true, std::memory_order_release);
+		}
+
+		return &gComb;
+	}
+
+	// r = g^e mod N
+	static bool gexp(Ctx& c, MD& r, const MD& e)
+	{
+		const MDComb* comb = gc(c);
+		return comb != nullptr && comb->exp(c.md, r, e);
+	}
 
 	Verifier::Verifier(
+		Ctx& c,
 		const char *I,
 		const char *p,
 		const uint8_t* s
 	)
 	{
-		init(I, p, s);
+		init(c, I, p, s);
 	}
 
-	void Verifier::init(
+	bool Verifier::init(
+		Ctx& c,
 		const char *I_,
 		const char *p_,
 		const uint8_t* s_
@@ -104,13 +167,55 @@ namespace Srp
 		I = I_;
 		p = p_;
 		
-		init(s_);
+		return init(c, s_);
 	}
 
-	void Verifier::init(const uint8_t* s_)
+	bool Verifier::init(
+		Ctx& c,
+		const char *I_,
+		const char *p_,
+		const uint8_t* s_,
+		const uint8_t* v_
+	)
 	{
-//		uint8_t* t = reinterpret_cast<uint8_t*>(tmp);
+		I = I_;
+		p = p_;
+
+		memcpy(s, s_, sizeof(s));
+		memset(x, 0, sizeof(x));
+		memcpy(v, v_, sizeof(v));
+
+		// comb table for v^u
+		c.t2.init(v, SRP_VERIFIER_BYTES);
+		return vc.init(c.md, c.t2);
+	}
+
+	bool Verifier::init(Ctx& c, const uint8_t* s_)
+	{
+		if (!initV(c, s_))
+			return false;
+
+		// comb table for v^u
+		c.t2.init(v, SRP_VERIFIER_BYTES);
+		return vc.init(c.md, c.t2);
+	}
+
+	bool Verifier::initV(Ctx& c, const uint8_t* s_)
+	{
+		initX(c, s_);
 
+		// Precalculate on Host and store:
+		// v = g^x	 - password verifier
+		c.t1.init(x, sizeof(x));
+		if (!gexp(c, c.t2, c.t1))		// t2 = v = g^x
+			return false;
+		c.t2.val(v, SRP_VERIFIER_BYTES);
+
+		return true;
+	}
+
+	void Verifier::initX(Ctx& c, const uint8_t* s_)
+	{
 		if (s_ != NULL)
 			memcpy(s, s_, sizeof(s));
 		else
@@ -119,20 +224,14 @@ namespace Srp
 		// Calculate on Host when Host creates user record:
 		// Calculate on User when user enters password:
 		// x = H(s | H(I | ":" | p))
-		memcpy(t, s, SRP_SALT_BYTES);				// t = s
-		sha.init();
-		sha.update(I, (uint32_t)strlen(I));
-		sha.update(":", 1);
-		sha.update(p, (uint32_t)strlen(p));
-		sha.fini(t + SRP_SALT_BYTES);				// t = s | H(I | ":" | p)
-		sha.calc(t, SRP_SALT_BYTES + Crypto::Sha512::HASH_SIZE_BYTES, hash);
-		t1.init(hash, sizeof(hash));				// x = H(s | H(I | ":" | p))
-		t1.val(x);
-
-		// Precalculate on Host and store:
-		// v = g^x	 - password verifier
-		t2.expMod(g, t1/*, tmp*/);			// 1D^16D
-		t2.val(v, SRP_VERIFIER_BYTES);
+		memcpy(c.t, s, SRP_SALT_BYTES);				// t = s
+		c.sha.init();
+		c.sha.update(I, (uint32_t)strlen(I));
+		c.sha.update(":", 1);
+		c.sha.update(p, (uint32_t)strlen(p));
+		c.sha.fini(c.t + SRP_SALT_BYTES);			// t = s | H(I | ":" | p)
+		c.sha.calc(c.t, SRP_SALT_BYTES + Crypto::Sha512::HASH_SIZE_BYTES, c.hash);
+		memcpy(x, c.hash, sizeof(x));				// x = H(s | H(I | ":" | p))
 	}
 
 	bool Host::open(uint8_t id)
@@ -171,63 +270,98 @@ namespace Srp
 		return false;
 	}
 
-	void Host::init(
+	bool Host::calc(
+		Ctx& c,
+		Ephemeral& e,
+		const uint8_t s[SRP_SALT_BYTES],
+		const uint8_t v[SRP_VERIFIER_BYTES],
 		const uint8_t* b
 	)
 	{
+		memcpy(e.s, s, SRP_SALT_BYTES);
+
 		if (b != nullptr)
-			_b.init(b, SRP_PRIVATE_BYTES);
+			memcpy(e.b, b, SRP_PRIVATE_BYTES);
 		else
-			_b.random();
+			Crypto::rnd_data(e.b, SRP_PRIVATE_BYTES);
 
 		// k = H(N, g)
-		memcpy(t, N_val, SRP_MODULO_BYTES);
-		memset(t + SRP_MODULO_BYTES, 0, SRP_MODULO_BYTES - sizeof(g_val));
-		memcpy(t + SRP_MODULO_BYTES * 2 - sizeof(g_val), g_val, sizeof(g_val));
-		sha.calc(t, SRP_MODULO_BYTES * 2, hash);
-		t4.init(hash, sizeof(hash));	// t4 = k
+		memcpy(c.t, N_val, SRP_MODULO_BYTES);
+		memset(c.t + SRP_MODULO_BYTES, 0, SRP_MODULO_BYTES - sizeof(g_val));
+		memcpy(c.t + SRP_MODULO_BYTES * 2 - sizeof(g_val), g_val, sizeof(g_val));
+		c.sha.calc(c.t, SRP_MODULO_BYTES * 2, c.hash);
+		c.t4.init(c.hash, sizeof(c.hash));	// t4 = k
 
 		// B = kv + g^b
-		t2.init(_ver.v, SRP_VERIFIER_BYTES);	// t2 = v
-		t1.mulMod(t4, t2); 						// t1 = k*v
-		t3.expMod(g, _b);						// t3 = g^b		1D^8D
-		t2.addMod(t1, t3);						// t2 = B = t1 + t3 
-		t2.val(B, SRP_PUBLIC_BYTES);
+		MDl<SRP_PRIVATE_BYTES> eb(e.b);
+		c.t2.init(v, SRP_VERIFIER_BYTES);	// t2 = v
+		if (!c.t1.mulMod(c.md, c.t4, c.t2)	// t1 = k*v
+			|| !gexp(c, c.t3, eb)			// t3 = g^b
+			|| !c.t2.addMod(c.md, c.t1, c.t3))	// t2 = B = t1 + t3 
+			return false;
+		c.t2.val(e.B, SRP_PUBLIC_BYTES);
+
+		return true;
+	}
+
+	bool Host::init(
+		Ctx& c,
+		const uint8_t* b
+	)
+	{
+		Ephemeral e;
+
+		if (!calc(c, e, _ver.s, _ver.v, b))
+			return false;
+		return init(e);
+	}
+
+	bool Host::init(
+		const Ephemeral& e
+	)
+	{
+		if (memcmp(e.s, _ver.s, SRP_SALT_BYTES) != 0)
+			return false;
+
+		_b.init(e.b, SRP_PRIVATE_BYTES);
+		memcpy(B, e.B, SRP_PUBLIC_BYTES);
+
+		return true;
 	}
 
-	void Host::setA(
+	bool Host::setA(
+		Ctx& c,
 		const uint8_t A[SRP_PUBLIC_BYTES]		// Public value from user
 	)
 	{
 		// u = H(A, B)
-		sha.init();
-		sha.update(A, SRP_PUBLIC_BYTES);
-		sha.update(B, SRP_PUBLIC_BYTES);
-		sha.fini(hash);
-		t4.init(hash, sizeof(hash));			// t4 = u
+		c.sha.init();
+		c.sha.update(A, SRP_PUBLIC_BYTES);
+		c.sha.update(B, SRP_PUBLIC_BYTES);
+		c.sha.fini(c.hash);
+		c.t4.init(c.hash, sizeof(c.hash));		// t4 = u
 
 		// S = (Av^u)^b
-		t2.init(_ver.v, SRP_VERIFIER_BYTES);	// t2 = v
-		t1.expMod(t2, t4);						// t1 = v^u		96D^16D
-		t4.init(A, SRP_PUBLIC_BYTES);			// t4 = A
-		t2.mulMod(t4, t1);						// t2 = A*v^u
-		t3.expMod(t2, _b);						// t3 = S = (Av^u)^b	96D^8D
+		if (!_ver.vc.exp(c.md, c.t1, c.t4))		// t1 = v^u
+			return false;
+		c.t4.init(A, SRP_PUBLIC_BYTES);			// t4 = A
+		if (!c.t2.mulMod(c.md, c.t4, c.t1)		// t2 = A*v^u
+			|| !c.t3.expMod(c.md, c.t2, _b))	// t3 = S = (Av^u)^b	96D^8D
+			return false;
 
 		// K = H(S)  - session key 
-		t3.val(t);
-		sha.calc(t, SRP_PUBLIC_BYTES, hash);
-		t4.init(hash, sizeof(hash));			// t4 = K
-		t4.val(K);
+		c.t3.val(c.t, SRP_PUBLIC_BYTES);		// S padded to N length
+		c.sha.calc(c.t, SRP_PUBLIC_BYTES, K);
 
 		// M = H(H(N) xor H(g) | H(I) | s | A | B | K)
 		_M.init();
-		sha.calc(N_val, sizeof(N_val), t);
-		sha.calc(g_val, sizeof(g_val), t + Crypto::Sha512::HASH_SIZE_BYTES);
+		c.sha.calc(N_val, sizeof(N_val), c.t);
+		c.sha.calc(g_val, sizeof(g_val), c.t + Crypto::Sha512::HASH_SIZE_BYTES);
 		for (uint32_t i = 0; i < Crypto::Sha512::HASH_SIZE_BYTES; i++)
-			t[i] ^= t[i + Crypto::Sha512::HASH_SIZE_BYTES];
-		_M.update(t, Crypto::Sha512::HASH_SIZE_BYTES);
-		sha.calc((const uint8_t*)_ver.I, (uint32_t)strlen(_ver.I), t);
-		_M.update(t, Crypto::Sha512::HASH_SIZE_BYTES);
+			c.t[i] ^= c.t[i + Crypto::Sha512::HASH_SIZE_BYTES];
+		_M.update(c.t, Crypto::Sha512::HASH_SIZE_BYTES);
+		c.sha.calc((const uint8_t*)_ver.I, (uint32_t)strlen(_ver.I), c.t);
+		_M.update(c.t, Crypto::Sha512::HASH_SIZE_BYTES);
 		_M.update(_ver.s, SRP_SALT_BYTES);
 		_M.update(A, SRP_PUBLIC_BYTES);
 		_M.update(B, SRP_PUBLIC_BYTES);
@@ -236,11 +370,15 @@ namespace Srp
 		// _V = H(A)
 		_V.init();
 		_V.update(A, SRP_PUBLIC_BYTES);
+
+		return true;
 	}
 
 
 	bool Host::verify(uint8_t* M, uint32_t len, uint8_t* V)
 	{
+		uint8_t hash[Crypto::Sha512::HASH_SIZE_BYTES];
+
 		_M.fini(hash);
 
 		if (len != Crypto::Sha512::HASH_SIZE_BYTES
@@ -262,6 +400,7 @@ namespace Srp
 	}
 	
 	User::User(
+		Ctx& c,
 		const char * username,				// username
 		const char * password,				// password
 		const uint8_t a[SRP_PRIVATE_BYTES]	// Private value (random)
@@ -272,66 +411,73 @@ namespace Srp
 
 		// A = g^a
 		_a.init(a, SRP_PRIVATE_BYTES);	// t1 = a
-		t2.expMod(g, _a);				// t2 = A = g^a		1D^8D
-		t2.val(_A);
+		_valid = gexp(c, c.t2, _a);		// t2 = A = g^a
+		c.t2.val(_A, SRP_PUBLIC_BYTES);
 
 		// M = (H(N) xor H(g)) | H(I)
 		_M.init();
-		sha.calc(N_val, sizeof(N_val), t);
-		sha.calc(g_val, sizeof(g_val), t + Crypto::Sha512::HASH_SIZE_BYTES);
+		c.sha.calc(N_val, sizeof(N_val), c.t);
+		c.sha.calc(g_val, sizeof(g_val), c.t + Crypto::Sha512::HASH_SIZE_BYTES);
 		for (uint32_t i = 0; i < Crypto::Sha512::HASH_SIZE_BYTES; i++)
-			t[i] ^= t[i + Crypto::Sha512::HASH_SIZE_BYTES];
-		_M.update(t, Crypto::Sha512::HASH_SIZE_BYTES);
-		sha.calc((const uint8_t*)ver.I, (uint32_t)strlen(ver.I), t);
-		_M.update(t, Crypto::Sha512::HASH_SIZE_BYTES);
+			c.t[i] ^= c.t[i + Crypto::Sha512::HASH_SIZE_BYTES];
+		_M.update(c.t, Crypto::Sha512::HASH_SIZE_BYTES);
+		c.sha.calc((const uint8_t*)ver.I, (uint32_t)strlen(ver.I), c.t);
+		_M.update(c.t, Crypto::Sha512::HASH_SIZE_BYTES);
 
 		// _V = H(A)
 		_V.init();
 		_V.update(_A, SRP_PUBLIC_BYTES);
 	}
 
-	void User::auth(
+	bool User::auth(
+		Ctx& c,
 		const uint8_t s[SRP_SALT_BYTES],	// salt from host
 		const uint8_t B[SRP_PUBLIC_BYTES]	// Public value from host
 	)
 	{
-		ver.init(s);
+		if (!_valid)
+			return false;
+
+		ver.initX(c, s);
 
 		// k = H(N, g)
-		memcpy(t, N_val, SRP_MODULO_BYTES);
-		memset(t + SRP_MODULO_BYTES, 0, SRP_MODULO_BYTES - sizeof(g_val));
-		memcpy(t + SRP_MODULO_BYTES * 2 - sizeof(g_val), g_val, sizeof(g_val));
-		sha.calc(t, SRP_MODULO_BYTES * 2, hash);
-		MDl<sizeof(hash)> k(hash);
+		memcpy(c.t, N_val, SRP_MODULO_BYTES);
+		memset(c.t + SRP_MODULO_BYTES, 0, SRP_MODULO_BYTES - sizeof(g_val));
+		memcpy(c.t + SRP_MODULO_BYTES * 2 - sizeof(g_val), g_val, sizeof(g_val));
+		c.sha.calc(c.t, SRP_MODULO_BYTES * 2, c.hash);
+		MDl<Crypto::Sha512::HASH_SIZE_BYTES> k(c.hash);
 
 		// u = H(A, B)
-		sha.init();
-		sha.update(_A, SRP_PUBLIC_BYTES);
-		sha.update(B, SRP_PUBLIC_BYTES);
-		sha.fini(hash);
-		MDl<sizeof(hash)> _u(hash);
+		c.sha.init();
+		c.sha.update(_A, SRP_PUBLIC_BYTES);
+		c.sha.update(B, SRP_PUBLIC_BYTES);
+		c.sha.fini(c.hash);
+		MDl<Crypto::Sha512::HASH_SIZE_BYTES> _u(c.hash);
 
 		// S = (B - kg^x) ^ (a + ux)
-		t4.init(ver.x, Crypto::Sha512::HASH_SIZE_BYTES);	// t4 = x
-		t3.init(B, SRP_PUBLIC_BYTES);	// t3 = B
-		t1.expMod(g, t4);				// t1 = g^x			1D^16D
-		t2.mulMod(k, t1);				// t2 = k*g^x
-		t1.sub(t3, t2);					// t1 = B - kg^x
-		t2.mulMod(_u, t4);				// t2 = u*x
-		t4.addMod(_a, t2);				// t4 = a+ux
-		t2.expMod(t1, t4);				// t2 = S = (B - kg^x) ^ (a + ux)	96D^16D
+		c.t4.init(ver.x, Crypto::Sha512::HASH_SIZE_BYTES);	// t4 = x
+		c.t3.init(B, SRP_PUBLIC_BYTES);	// t3 = B
+		if (!gexp(c, c.t1, c.t4)			// t1 = g^x
+			|| !c.t2.mulMod(c.md, k, c.t1))	// t2 = k*g^x
+			return false;
+		if (c.t1.sub(c.t3, c.t2))		// t1 = B - kg^x
+			c.t1.add(c.t1, c.md.mod.N);	//	wrapped below zero, bring back into [0, N)
+		if (!c.t2.mulMod(c.md, _u, c.t4)	// t2 = u*x
+			|| !c.t4.addMod(c.md, _a, c.t2)	// t4 = a+ux
+			|| !c.t2.expMod(c.md, c.t1, c.t4))	// t2 = S = (B - kg^x) ^ (a + ux)	96D^16D
+			return false;
 
 		// K = H(S)
-		t2.val(t);
-		sha.calc(t, SRP_PUBLIC_BYTES, hash);
-		t1.init(hash, sizeof(hash));
-		t1.val(_K);
+		c.t2.val(c.t, SRP_PUBLIC_BYTES);	// S padded to N length
+		c.sha.calc(c.t, SRP_PUBLIC_BYTES, _K);
 
 		// M = H(H(N) xor H(g) | H(I) | s | A | B | K)
 		_M.update(s, SRP_SALT_BYTES);
 		_M.update(_A, SRP_PUBLIC_BYTES);
 		_M.update(B, SRP_PUBLIC_BYTES);
 		_M.update(_K, Crypto::Sha512::HASH_SIZE_BYTES);
+
+		return true;
 	}
 
 	void User::proof(uint8_t M[Crypto::Sha512::HASH_SIZE_BYTES])
@@ -345,6 +491,8 @@ namespace Srp
 
 	bool User::verify(uint8_t* V, uint32_t len)
 	{
+		uint8_t hash[Crypto::Sha512::HASH_SIZE_BYTES];
+
 		_V.fini(hash);
 
 		if (len != Crypto::Sha512::HASH_SIZE_BYTES
@@ -70,22 +70,61 @@ namespace Srp
 	constexpr uint32_t SRP_KEY_BYTES = Crypto::Sha512::HASH_SIZE_BYTES;
 	constexpr uint32_t SRP_PROOF_BYTES = Crypto::Sha512::HASH_SIZE_BYTES;
 
+	// Ctx - SRP calculation context: modulus, MD temp storage and temp data
+	//	SRP calculations running in parallel must use separate contexts
+	class Ctx
+	{
+	public:
+		Ctx();
+
+		MDCtxl<SRP_MODULO_BYTES> md;
+		MDl<SRP_MODULO_BYTES> t1, t2, t3, t4;
+		Crypto::Sha512 sha;
+		uint8_t hash[Crypto::Sha512::HASH_SIZE_BYTES];
+		uint8_t t[SRP_MODULO_BYTES * 2];
+	};
+
 	// Verifier - password verifier generator
 	class Verifier
 	{
 	public:
 		Verifier() {}
 		Verifier(
+			Ctx& c,
 			const char *I,
 			const char *p,
 			const uint8_t* s = nullptr
 		);
-		void init(
+		// init functions return false if the calculation failed
+		bool init(
+			Ctx& c,
 			const char *I_,
 			const char *p_,
 			const uint8_t* s = nullptr
 		);
-		void init(
+		bool init(
+			Ctx& c,
+			const uint8_t* s_ = nullptr
+		);
+
+		// restore precalculated salt and verifier
+		bool init(
+			Ctx& c,
+			const char *I_,
+			const char *p_,
+			const uint8_t* s_,
+			const uint8_t* v_
+		);
+
+		// calculate s, x and v without comb table (provisioning)
+		bool initV(
+			Ctx& c,
+			const uint8_t* s_ = nullptr
+		);
+
+		// calculate s and x only (User side)
+		void initX(
+			Ctx& c,
 			const uint8_t* s_ = nullptr
 		);
 
@@ -94,6 +133,9 @@ namespace Srp
 		uint8_t s[SRP_SALT_BYTES];
 		uint8_t x[Crypto::Sha512::HASH_SIZE_BYTES];
 		uint8_t v[SRP_VERIFIER_BYTES];
+
+		// fixed-base comb table for v^u, built by init
+		MDCombl<SRP_VERIFIER_BYTES, Crypto::Sha512::HASH_SIZE_BYTES * 8> vc;
 	};
 
 	// Host
@@ -109,11 +151,40 @@ namespace Srp
 		bool close(uint8_t id);
 		bool active(uint8_t id = 0xFF);
 
-		void init(
+		// Ephemeral - private value b and public value B = kv + g^b
+		//	does not depend on user input, can be calculated in advance
+		struct Ephemeral
+		{
+			uint8_t s[SRP_SALT_BYTES];		// salt of the verifier B is calculated for
+			uint8_t b[SRP_PRIVATE_BYTES];
+			uint8_t B[SRP_PUBLIC_BYTES];
+		};
+
+		// calculate ephemeral for verifier v with salt s
+		//	returns false if the calculation failed
+		static bool calc(
+			Ctx& c,
+			Ephemeral& e,
+			const uint8_t s[SRP_SALT_BYTES],
+			const uint8_t v[SRP_VERIFIER_BYTES],
 			const uint8_t* b = nullptr				// Private value [SRP_PRIVATE_BYTES]
 			);
 
-		void setA(
+		// returns false if B calculation failed
+		bool init(
+			Ctx& c,
+			const uint8_t* b = nullptr				// Private value [SRP_PRIVATE_BYTES]
+			);
+
+		// init from precalculated ephemeral
+		//	returns false if the ephemeral was calculated for different verifier
+		bool init(
+			const Ephemeral& e
+			);
+
+		// returns false if S calculation failed
+		bool setA(
+			Ctx& c,
 			const uint8_t A[SRP_PUBLIC_BYTES]		// Public value from user
 			);
 
@@ -137,12 +208,15 @@ namespace Srp
 	{
 	public:
 		User(
+			Ctx& c,
 			const char * username,				// username
 			const char * password,				// password
 			const uint8_t a[SRP_PRIVATE_BYTES]	// Private value (random)
 		);
 
-		void auth(
+		// returns false if A or S calculation failed
+		bool auth(
+			Ctx& c,
 			const uint8_t s[SRP_SALT_BYTES],	// salt from host
 			const uint8_t B[SRP_PUBLIC_BYTES]	// Public value from host
 		);
@@ -157,6 +231,7 @@ namespace Srp
 		Verifier ver;
 		Crypto::Sha512 _M, _V;
 		MDl<SRP_PRIVATE_BYTES> _a;
+		bool _valid;						// A is calculated
 		uint8_t _A[Srp::SRP_PUBLIC_BYTES];
 		uint8_t _K[Crypto::Sha512::HASH_SIZE_BYTES];
 	};
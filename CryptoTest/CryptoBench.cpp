@@ -0,0 +1,212 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "CryptoTest/CryptoTest.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace CryptoTest
+{
+	static constexpr uint64_t SampleNs = 20000;			// min duration of one sample, well above timer resolution
+	static constexpr uint64_t BudgetNs = 300000000;		// time spent on one case
+	static constexpr unsigned MinSamples = 20;
+	static constexpr unsigned MaxSamples = 2000;
+
+	static uint64_t ns(Timer::Point t1, Timer::Point t2)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+	}
+
+	// sample = batch of operations timed together, batch is sized to SampleNs
+	//	operations with preparation are timed one by one
+	BenchResult run(const BenchCase& b, uint64_t hz)
+	{
+		std::vector<double> smp;
+		uint64_t total = 0;
+		uint64_t batch = 1;
+
+		// warm up and size the batch
+		if (b.prep)
+			b.prep();
+		b.op();
+		if (b.prep)
+			b.prep();
+		Timer::Point t1 = Timer::now();
+		b.op();
+		Timer::Point t2 = Timer::now();
+		uint64_t t = ns(t1, t2);
+		if (!b.prep && t < SampleNs)
+			batch = t > 0 ? SampleNs / t : SampleNs;
+
+		while (smp.size() < MaxSamples && (total < BudgetNs || smp.size() < MinSamples))
+		{
+			if (b.prep)
+				b.prep();
+
+			t1 = Timer::now();
+			for (uint64_t i = 0; i < batch; i++)
+				b.op();
+			t2 = Timer::now();
+
+			t = ns(t1, t2);
+			total += t;
+			smp.push_back(double(t) / batch);
+		}
+
+		std::sort(smp.begin(), smp.end());
+
+		BenchResult r;
+		r.name = b.name;
+		r.bytes = b.bytes;
+		r.iterations = smp.size() * batch;
+		r.ns = double(total) / r.iterations;
+		r.p50 = smp[smp.size() / 2];
+		r.p99 = smp[std::min(smp.size() - 1, smp.size() * 99 / 100)];
+		r.bpc = (hz != 0 && b.bytes != 0) ? b.bytes / (r.ns * hz / 1e9) : 0;
+
+		return r;
+	}
+
+	static void json(const char* fileName, uint64_t hz, const std::vector<BenchResult>& res)
+	{
+		static const char* prim[] = { "mul", "sqr", "sha512", "chacha20", "poly1305" };
+
+		FILE* f = fopen(fileName, "w");
+		if (f == NULL)
+		{
+			LOG_MSG("Bench: cannot open %s for write\n", fileName);
+			return;
+		}
+
+		fprintf(f, "{\n");
+		fprintf(f, "\t\"cpu_hz\":%llu,\n", (unsigned long long)hz);
+		fprintf(f, "\t\"digit_bits\":%u,\n", MD::D_BITS);
+
+		fprintf(f, "\t\"kernels\":{");
+		for (unsigned i = 0; i < sizeofarr(prim); i++)
+			fprintf(f, "%s\"%s\":\"%s\"", i ? "," : "", prim[i], Crypto::selected(prim[i]));
+		fprintf(f, "},\n");
+
+		fprintf(f, "\t\"results\":[\n");
+		for (size_t i = 0; i < res.size(); i++)
+		{
+			const BenchResult& r = res[i];
+			fprintf(f, "\t\t%c{\"name\":\"%s\",\"bytes\":%u,\"iterations\":%llu,\"ns_op\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"bytes_per_cycle\":%.4f}\n",
+				i ? ',' : ' ', r.name, r.bytes, (unsigned long long)r.iterations, r.ns, r.p50, r.p99, r.bpc);
+		}
+		fprintf(f, "\t]\n");
+		fprintf(f, "}\n");
+
+		fclose(f);
+
+		LOG_MSG("Bench: results saved to %s\n", fileName);
+	}
+}
+
+// run benchmark of all crypto primitives, save results to json file if fileName is provided
+int cryptoBench(const char* fileName)
+{
+	using namespace CryptoTest;
+
+	static uint8_t msg[1024], out[1024];
+	static uint8_t key[32], nonce[Crypto::Aead::NONCE_SIZE_BYTES], tag[Crypto::Aead::TAG_SIZE_BYTES];
+	static uint8_t aad[2] = { 0x00, 0x04 };		// HAP frame length
+	static uint8_t hash[Crypto::Sha512::HASH_SIZE_BYTES];
+	static uint8_t secret[Crypto::Curve25519::KEY_SIZE_BYTES], prv[Crypto::Curve25519::KEY_SIZE_BYTES], pub[Crypto::Curve25519::KEY_SIZE_BYTES];
+	static uint8_t sign[Crypto::Ed25519::SIGN_SIZE_BYTES];
+	static uint8_t A[Srp::SRP_PUBLIC_BYTES], M[Srp::SRP_PROOF_BYTES];
+
+	LOG_MSG("Crypto bench\n");
+
+	Crypto::select();
+
+	Crypto::rnd_data(msg, sizeof(msg));
+	Crypto::rnd_data(key, sizeof(key));
+	Crypto::rnd_data(nonce, sizeof(nonce));
+	Crypto::rnd_data(prv, sizeof(prv));
+	Crypto::rnd_data(pub, sizeof(pub));
+
+	Crypto::Sha512 sha;
+	Crypto::Chacha20 cha;
+	Crypto::Aead aead;
+	Crypto::Ed25519 ed;
+	ed.init();
+	ed.sign(sign, msg, 64);
+
+	// SRP size operands
+	Srp::Ctx* c = new Srp::Ctx;
+	MDl<Srp::SRP_MODULO_BYTES> x, y, r;
+	MDl<Srp::SRP_MODULO_BYTES * 2> p;
+	MDl<Srp::SRP_PRIVATE_BYTES> e;
+	x.random();
+	y.random();
+	e.random();
+	x.mulMod(c->md, x, y);		// x, y < N
+	y.mulMod(c->md, y, x);
+
+	// host side of pair setup: B, then S, K and M check for user's A
+	//	the proof does not match, its check costs the same
+	Srp::Verifier* ver = new Srp::Verifier(*c, "Pair-Setup", "000-11-000");
+	uint8_t a[Srp::SRP_PRIVATE_BYTES];
+	Crypto::rnd_data(a, sizeof(a));
+	Srp::User* usr = new Srp::User(*c, "Pair-Setup", "000-11-000", a);
+	memcpy(A, usr->getA(), sizeof(A));
+	Crypto::rnd_data(M, sizeof(M));
+	Srp::Host* host = nullptr;
+
+	const BenchCase cases[] =
+	{
+		{ "sha512_64", 64, [&]() { sha.calc(msg, 64, hash); }, nullptr },
+		{ "sha512_1024", 1024, [&]() { sha.calc(msg, 1024, hash); }, nullptr },
+		{ "hmac_sha512_64", 64, [&]() { Crypto::HmacSha512(key, sizeof(key), msg, 64, hash, sizeof(hash)); }, nullptr },
+		{ "hkdf_sha512", 0, [&]() { Crypto::HkdfSha512(key, sizeof(key), msg, 32, msg + 32, 32, out, 32); }, nullptr },
+		{ "chacha20_1024", 1024, [&]() { cha.encrypt(key, 1, nonce, msg, 1024, out); }, nullptr },
+		{ "poly1305_1024", 1024, [&]() { Crypto::Poly1305(key, msg, 1024, tag); }, nullptr },
+		{ "aead_enc_64", 64, [&]() { aead.encrypt(out, tag, key, nonce, msg, 64, aad, sizeof(aad)); }, nullptr },
+		{ "aead_enc_1024", 1024, [&]() { aead.encrypt(out, tag, key, nonce, msg, 1024, aad, sizeof(aad)); }, nullptr },
+		{ "aead_dec_1024", 1024, [&]() { aead.decrypt(out, tag, key, nonce, msg, 1024, aad, sizeof(aad)); }, nullptr },
+		{ "curve25519", 0, [&]() { Crypto::Curve25519::calculate(secret, prv, pub); }, nullptr },
+		{ "ed25519_sign", 0, [&]() { ed.sign(sign, msg, 64); }, nullptr },
+		{ "ed25519_verify", 0, [&]() { ed.verify(sign, msg, 64, ed.pubKey()); }, nullptr },
+		{ "md_mul", 0, [&]() { p.mul(x, y, &c->md); }, nullptr },
+		{ "md_sqr", 0, [&]() { p.sqr(x, &c->md); }, nullptr },
+		{ "md_expmod_256", 0, [&]() { r.expMod(c->md, x, e); }, nullptr },
+		{ "srp_host", 0,
+			[&]() {
+				host->init(*c);
+				host->setA(*c, A);
+				host->verify(M, sizeof(M));
+			},
+			[&]() {
+				delete host;
+				host = new Srp::Host(*ver);
+			}
+		},
+	};
+
+	uint64_t hz = Timer::cpuHz();
+	std::vector<BenchResult> res;
+
+	LOG_MSG("cpu %llu MHz\n", (unsigned long long)(hz / 1000000));
+	LOG_MSG("%-16s %6s %10s %12s %12s %12s %8s\n", "name", "bytes", "iter", "ns/op", "p50", "p99", "B/cycle");
+	for (unsigned i = 0; i < sizeofarr(cases); i++)
+	{
+		BenchResult b = run(cases[i], hz);
+		LOG_MSG("%-16s %6u %10llu %12.1f %12.1f %12.1f %8.4f\n", b.name, b.bytes,
+			(unsigned long long)b.iterations, b.ns, b.p50, b.p99, b.bpc);
+		res.push_back(b);
+	}
+
+	if (fileName != nullptr)
+		json(fileName, hz, res);
+
+	delete host;
+	delete usr;
+	delete ver;
+	delete c;
+
+	return 0;
+}
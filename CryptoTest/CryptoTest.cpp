@@ -26,6 +26,7 @@ int cryptoTest()
 	int r = 0;
 
 	MD::cntMul = MD::cntMulS = MD::cntMulK = 0;
+	MD::cntSqr = MD::cntSqrK = MD::cntMont = 0;
 
 #if 1
 	r += runTest(CryptoTest::sha512_test);
@@ -36,6 +37,8 @@ int cryptoTest()
 
 	r += runTest(CryptoTest::chacha20_test);
 
+	r += runTest(CryptoTest::drbg_test);
+
 	r += runTest(CryptoTest::poly1305_test);
 
 	r += runTest(CryptoTest::aead_test);
@@ -43,15 +46,24 @@ int cryptoTest()
 	r += runTest(CryptoTest::curve25519_test);
 
 	r += runTest(CryptoTest::ed25519_test);
+
+	r += runTest(CryptoTest::select_test);
 #endif
 #if 1
 	r += runTest(CryptoTest::srp_test);
 #endif
-#if 0
+#if 1
+	r += runTest(CryptoTest::json_test);
+#endif
+#if 1
 	r += runTest(CryptoTest::md_test);
 #endif
+#if 0
+	r += runTest(CryptoTest::md_bench);
+#endif
 
-	LOG_MSG("\nCrypto Test: %s  Mul %d  MulS %d  MulK %d\n", r ? "FAIL" : "PASS", MD::cntMul, MD::cntMulS, MD::cntMulK);
+	LOG_MSG("\nCrypto Test: %s  Mul %d  MulS %d  MulK %d  Sqr %d  SqrK %d  Mont %d\n", r ? "FAIL" : "PASS",
+		MD::cntMul, MD::cntMulS, MD::cntMulK, MD::cntSqr, MD::cntSqrK, MD::cntMont);
 
 	return r;
 }
@@ -12,20 +12,56 @@
 #include "Crypto/MD.h"
 #include "Crypto/Srp.h"
 
+#include <functional>
+
 namespace CryptoTest
 {
 	int sha512_test();
 	int hmac_test();
 	int hkdf_test();
 	int chacha20_test();
+	int drbg_test();
 	int poly1305_test();
 	int aead_test();
 	int curve25519_test();
 	int ed25519_test();
+	int select_test();
 	int md_test();
+	int md_bench();
 	int srp_test();
+	int json_test();
+
+	// one benchmarked operation
+	struct BenchCase
+	{
+		const char* name;
+		uint32_t bytes;					// bytes processed per operation, 0 for fixed size operations
+		std::function<void()> op;
+		std::function<void()> prep;		// optional untimed preparation before each operation
+	};
+
+	struct BenchResult
+	{
+		const char* name;
+		uint32_t bytes;
+		uint64_t iterations;
+		double ns;						// mean ns per operation
+		double p50;						// median of samples, ns per operation
+		double p99;						// 99th percentile of samples, ns per operation
+		double bpc;						// bytes per cycle, 0 if unknown
+	};
+
+	// time one operation, hz is CPU clock or 0 if unknown
+	BenchResult run(const BenchCase& b, uint64_t hz);
 }
 
 int cryptoTest();
 
+// run crypto microbenchmarks, results are saved to json file fileName if provided
+int cryptoBench(const char* fileName = nullptr);
+
+// run GET /characteristics benchmark of numeric-heavy accessories and JSON parser benchmark,
+//	results are saved to json file fileName if provided
+int dbBench(const char* fileName = nullptr);
+
 #endif /*_CRYPTO_TEST_H_*/
\ No newline at end of file
@@ -0,0 +1,272 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "CryptoTest/CryptoTest.h"
+#include "Hap/Hap.h"
+
+#include <vector>
+#include <string>
+
+namespace CryptoTest
+{
+	// color light, all characteristics except Name are numbers
+	class BenchLb : public Hap::Lightbulb
+	{
+	private:
+		Hap::Characteristic::Name _name;
+		Hap::Characteristic::Brightness _brightness;
+		Hap::Characteristic::Hue _hue;
+		Hap::Characteristic::Saturation _saturation;
+	public:
+		BenchLb(int i)
+		{
+			AddName(_name);
+			AddBrightness(_brightness);
+			AddHue(_hue);
+			AddSaturation(_saturation);
+
+			_name.Value("Light");
+			_on.Value(i & 1);
+			_brightness.Value(100 - i * 7);
+			_hue.Value(17.3 + i * 41.7);
+			_saturation.Value(62.5 + i / 3.);
+		}
+
+		// append ids of value characteristics to GET /characteristics query
+		int ids(char* s, int size, Hap::iid_t aid)
+		{
+			return snprintf(s, size, "%u.%u,%u.%u,%u.%u,%u.%u,", aid, _on.getId(), aid, _brightness.getId(),
+				aid, _hue.getId(), aid, _saturation.getId());
+		}
+	};
+
+	class BenchAcc final : public Hap::Accessory<1>
+	{
+	private:
+		BenchLb _lb;
+	public:
+		BenchAcc(int i) : _lb(i)
+		{
+			AddService(&_lb);
+		}
+
+		int ids(char* s, int size)
+		{
+			return _lb.ids(s, size, getId());
+		}
+	};
+
+	static constexpr int BenchAccCount = 8;
+	static constexpr int BenchTokens = 8192;
+
+	// JSON payloads as received from controllers and stored in config file
+	struct BenchJson
+	{
+		const char* name;
+		std::string js;
+	};
+
+	static std::string configJson()
+	{
+		std::string hex;
+		for (int i = 0; i < 768; i++)
+			hex += "0123456789ABCDEF"[(i * 7) & 0xF];
+
+		std::string js = "{\n\t\"name\":\"Bench\",\n\t\"model\":\"BenchModel\",\n\t\"manufacturer\":\"BenchMaker\",\n"
+			"\t\"serialNumber\":\"0001\",\n\t\"firmwareRevision\":\"0.1\",\n\t\"deviceId\":\"D0:E4:73:FD:27:5A\",\n"
+			"\t\"configNum\":\"1\",\n\t\"categoryId\":\"5\",\n\t\"statusFlags\":\"1\",\n\t\"setupCode\":\"000-11-000\",\n"
+			"\t\"srp\":[\n\t\t \"" + hex.substr(0, 32) + "\"\n\t\t,\"" + hex + "\"\n\t\t,\"" + hex.substr(32, 32) + "\"\n\t],\n"
+			"\t\"port\":\"7889\",\n\t\"crypto\":\"\",\n"
+			"\t\"keys\":[\n\t\t \"" + hex.substr(0, 64) + "\"\n\t\t,\"" + hex.substr(0, 128) + "\"\n\t],\n"
+			"\t\"pairings\":[\n";
+		for (int i = 0; i < 4; i++)
+			js += std::string("\t\t") + (i ? "," : " ") + "[\"11111111-2222-3333-4444-55555555555" + char('0' + i) + "\",\"" + hex.substr(i, 64) + "\",\"1\"]\n";
+		js += "\t],\n\t\"db\":{\n";
+		for (int i = 0; i < BenchAccCount; i++)
+			js += std::string("\t\t\"Lb") + char('1' + i) + "\":{\n\t\t\t\"On\":1,\n\t\t\t\"Brightness\":75,\n\t\t\t\"Hue\":184.5,\n\t\t\t\"Saturation\":62.5\n\t\t}"
+				+ (i < BenchAccCount - 1 ? ",\n" : "\n");
+		js += "\t}\n}\n";
+
+		return js;
+	}
+
+	// PUT /characteristics of n characteristics
+	static std::string putJson(int n)
+	{
+		std::string js = "{\"characteristics\":[";
+		for (int i = 0; i < n; i++)
+		{
+			char s[64];
+			snprintf(s, sizeof(s), "%s{\"aid\":%d,\"iid\":%d,\"value\":%g}", i ? "," : "", i / 4 + 1, i % 4 + 9, 17.5 + i);
+			js += s;
+		}
+		js += "]}";
+
+		return js;
+	}
+
+	class BenchDb : public Hap::DbStatic<BenchAccCount>
+	{
+	public:
+		BenchAcc* acc[BenchAccCount];
+
+		BenchDb()
+		{
+			for (int i = 0; i < BenchAccCount; i++)
+			{
+				acc[i] = new BenchAcc(i);
+				acc[i]->setId(i + 1);
+				AddAcc(acc[i]);
+			}
+		}
+
+		~BenchDb()
+		{
+			for (int i = 0; i < BenchAccCount; i++)
+				delete acc[i];
+		}
+	};
+}
+
+int dbBench(const char* fileName)
+{
+	using namespace CryptoTest;
+
+	static char buf[16384];
+	static char query[512];
+	static char queryMeta[sizeof(query) + 32];
+	static const int32_t ints[] = { 0, 1, 100, -1, 254, 3000, -12345, 2147483647, 42, 65535, 7, 500, 18, 99, 360, 1000 };
+	static const double flts[] = { 0., 360., 17.3, 59., 100.8, 142.5, 184.2, 225.9, 62.5, 62.833333333333336, 0.1, 12.75, 33.3, 99.99, 1e-3, 271.35 };
+
+	LOG_MSG("Db bench\n");
+
+	BenchDb* db = new BenchDb;
+
+	int l = snprintf(query, sizeof(query), "id=");
+	for (int i = 0; i < BenchAccCount; i++)
+		l += db->acc[i]->ids(query + l, sizeof(query) - l);
+	query[--l] = 0;		// trailing comma
+	int lm = snprintf(queryMeta, sizeof(queryMeta), "%s&meta=1&perms=1&type=1", query);
+
+	// sizes of responses
+	Hap::Json::Writer w(buf, sizeof(buf));
+	db->Read(0, query, l, w);
+	uint32_t chrBytes = w.total();
+	LOG_MSG("%.*s\n", w.len(), buf);
+	w = Hap::Json::Writer(buf, sizeof(buf));
+	db->Read(0, queryMeta, lm, w);
+	uint32_t metaBytes = w.total();
+	w = Hap::Json::Writer(buf, sizeof(buf));
+	db->getDb(0, w);
+	uint32_t accBytes = w.total();
+
+	std::vector<BenchCase> cases =
+	{
+		{ "fmt_int_16", 0, [&]() {
+				Hap::Json::Writer w(buf, sizeof(buf));
+				for (auto v : ints)
+					w.val(v);
+			},
+			nullptr
+		},
+		{ "fmt_float_16", 0, [&]() {
+				Hap::Json::Writer w(buf, sizeof(buf));
+				for (auto v : flts)
+					w.val(v);
+			},
+			nullptr
+		},
+		{ "get_chr", chrBytes, [&]() {
+				Hap::Json::Writer w(buf, sizeof(buf));
+				db->Read(0, query, l, w);
+			},
+			nullptr
+		},
+		{ "get_chr_meta", metaBytes, [&]() {
+				Hap::Json::Writer w(buf, sizeof(buf));
+				db->Read(0, queryMeta, lm, w);
+			},
+			nullptr
+		},
+		{ "get_acc", accBytes, [&]() {
+				Hap::Json::Writer w(buf, sizeof(buf));
+				db->getDb(0, w);
+			},
+			nullptr
+		},
+	};
+
+	// JSON parser
+	static BenchJson json[] =
+	{
+		{ "jsmn_put_1", "{\"characteristics\":[{\"aid\":1,\"iid\":9,\"value\":1}]}" },
+		{ "jsmn_put_ev", "{\"characteristics\":[{\"aid\":1,\"iid\":9,\"ev\":true},{\"aid\":1,\"iid\":10,\"ev\":true},"
+			"{\"aid\":1,\"iid\":11,\"ev\":true},{\"aid\":1,\"iid\":12,\"ev\":true}]}" },
+		{ "jsmn_put_pid", "{\"characteristics\":[{\"aid\":2,\"iid\":11,\"value\":184.5}],\"pid\":11122333}" },
+		{ "jsmn_put_1000", putJson(1000) },
+		{ "jsmn_config", configJson() },
+	};
+	Hap::Json::jsmntok_t* tk = new Hap::Json::jsmntok_t[BenchTokens];
+
+	for (auto& j : json)
+	{
+		const char* js = j.js.data();
+		uint32_t len = uint32_t(j.js.size());
+		cases.push_back({ j.name, len, [=]() {
+				Hap::Json::jsmn_parser ps;
+				Hap::Json::jsmn_init(&ps);
+				Hap::Json::jsmn_parse(&ps, js, len, tk, BenchTokens);
+			},
+			nullptr
+		});
+	}
+
+	uint64_t hz = Timer::cpuHz();
+	std::vector<BenchResult> res;
+
+	LOG_MSG("%-16s %6s %10s %12s %12s %12s %8s\n", "name", "bytes", "iter", "ns/op", "p50", "p99", "B/cycle");
+	for (unsigned i = 0; i < cases.size(); i++)
+	{
+		// Db logs each request, keep the log out of timing
+		bool info = Log::Info;
+		Log::Info = false;
+		BenchResult b = run(cases[i], hz);
+		Log::Info = info;
+
+		LOG_MSG("%-16s %6u %10llu %12.1f %12.1f %12.1f %8.4f\n", b.name, b.bytes,
+			(unsigned long long)b.iterations, b.ns, b.p50, b.p99, b.bpc);
+		res.push_back(b);
+	}
+
+	if (fileName != nullptr)
+	{
+		FILE* f = fopen(fileName, "w");
+		if (f == NULL)
+			LOG_MSG("Bench: cannot open %s for write\n", fileName);
+		else
+		{
+			fprintf(f, "{\n");
+			fprintf(f, "\t\"cpu_hz\":%llu,\n", (unsigned long long)hz);
+			fprintf(f, "\t\"accessories\":%d,\n", BenchAccCount);
+			fprintf(f, "\t\"results\":[\n");
+			for (size_t i = 0; i < res.size(); i++)
+			{
+				const BenchResult& r = res[i];
+				fprintf(f, "\t\t%c{\"name\":\"%s\",\"bytes\":%u,\"iterations\":%llu,\"ns_op\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"bytes_per_cycle\":%.4f}\n",
+					i ? ',' : ' ', r.name, r.bytes, (unsigned long long)r.iterations, r.ns, r.p50, r.p99, r.bpc);
+			}
+			fprintf(f, "\t]\n");
+			fprintf(f, "}\n");
+			fclose(f);
+
+			LOG_MSG("Bench: results saved to %s\n", fileName);
+		}
+	}
+
+	delete[] tk;
+	delete db;
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "CryptoTest/CryptoTest.h"
+
+namespace CryptoTest
+{
+	static const uint8_t seed[Crypto::Drbg::SEED_SIZE_BYTES] =
+	{
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+	};
+
+	// first output follows the key in ChaCha20 block 0 of the seed
+	static int test_stream()
+	{
+		const uint8_t nonce[Crypto::Chacha20::NONCE_SIZE_BYTES] = { 0 };
+		uint8_t blk[Crypto::Chacha20::BLK_SIZE_BYTES];
+		uint8_t o[Crypto::Chacha20::BLK_SIZE_BYTES - Crypto::Drbg::SEED_SIZE_BYTES];
+
+		Crypto::Chacha20 cha;
+		cha.block(seed, 0, nonce, blk);
+
+		Crypto::Drbg drbg(seed);
+		drbg.generate(o, sizeof(o));
+
+		if (memcmp(o, blk + Crypto::Drbg::SEED_SIZE_BYTES, sizeof(o)) != 0)
+		{
+			LOG_MSG("Drbg stream mismatch\n");
+			return 1;
+		}
+
+		return 0;
+	}
+
+	// same seed and same requests produce same output, other seed does not
+	static int test_determinism()
+	{
+		int r = 0;
+		static const uint32_t req[] = { 1, 31, 32, 33, 480, 600, 7, 2048, 63, 512 };
+		static uint8_t o1[4096], o2[4096], o3[4096];
+
+		uint8_t seed3[Crypto::Drbg::SEED_SIZE_BYTES];
+		memcpy(seed3, seed, sizeof(seed3));
+		seed3[0] ^= 1;
+
+		Crypto::Drbg d1(seed), d2(seed), d3(seed3);
+
+		uint32_t len = 0;
+		for (unsigned i = 0; i < sizeofarr(req); i++)
+		{
+			d1.generate(o1 + len, req[i]);
+			d2.generate(o2 + len, req[i]);
+			d3.generate(o3 + len, req[i]);
+			len += req[i];
+		}
+
+		if (memcmp(o1, o2, len) != 0)
+		{
+			LOG_MSG("Drbg not deterministic\n");
+			r++;
+		}
+
+		if (memcmp(o1, o3, len) == 0)
+		{
+			LOG_MSG("Drbg ignores seed\n");
+			r++;
+		}
+
+		// reseed restarts the sequence
+		d1.init(seed);
+		d1.generate(o3, req[0]);
+		if (o3[0] != o2[0])
+		{
+			LOG_MSG("Drbg reseed mismatch\n");
+			r++;
+		}
+
+		return r;
+	}
+
+	// bulk fill throughput, and per-thread generator output
+	static int test_bulk()
+	{
+		int r = 0;
+		static uint8_t o[1024 * 1024];
+		uint8_t a[32], b[32];
+		Timer::Point d1, d2;
+
+		Crypto::Drbg drbg(seed);
+
+		d1 = Timer::now();
+		for (int i = 0; i < 8; i++)
+			drbg.generate(o, sizeof(o));
+		d2 = Timer::now();
+		LOG_MSG("Drbg bulk 8 MB duration: %lld us\n", Timer::us(d1, d2));
+
+		d1 = Timer::now();
+		for (unsigned i = 0; i < sizeof(o) / 32; i++)
+			Crypto::rnd_data(o + i * 32, 32);
+		d2 = Timer::now();
+		LOG_MSG("rnd_data 32 bytes x %d duration: %lld us\n", int(sizeof(o) / 32), Timer::us(d1, d2));
+
+		// sequential requests never repeat
+		Crypto::rnd_data(a, sizeof(a));
+		Crypto::rnd_data(b, sizeof(b));
+		if (memcmp(a, b, sizeof(a)) == 0)
+		{
+			LOG_MSG("rnd_data repeats\n");
+			r++;
+		}
+
+		return r;
+	}
+
+	int drbg_test()
+	{
+		int r = 0;
+
+		LOG_MSG("Drbg test\n");
+
+		r += test_stream();
+
+		r += test_determinism();
+
+		r += test_bulk();
+
+		return r;
+	}
+}
@@ -0,0 +1,142 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "CryptoTest/CryptoTest.h"
+#include "Hap/Hap.h"
+
+#include <vector>
+#include <string>
+
+namespace CryptoTest
+{
+	// result of splitting one PUT /characteristics body
+	struct Split
+	{
+		std::vector<std::string> elm;
+		bool ok = true;		// no scan error
+		bool done = false;
+
+		bool operator==(const Split& s) const
+		{
+			return elm == s.elm && ok == s.ok && done == s.done;
+		}
+	};
+
+	// feed body in two pieces split at offset, unconsumed bytes are passed again with the next piece
+	static Split split(const std::string& body, size_t offset)
+	{
+		Hap::Json::Splitter sp;
+		Split s;
+		std::string pending;
+
+		sp.init("characteristics");
+
+		auto elm = [&s](const char* js, int len) -> bool {
+			s.elm.emplace_back(js, len);
+			return true;
+		};
+
+		for (auto piece : { body.substr(0, offset), body.substr(offset) })
+		{
+			pending += piece;
+			int n = sp.scan(pending.data(), int(pending.size()), elm);
+			if (n < 0)
+			{
+				s.ok = false;
+				return s;
+			}
+			pending.erase(0, n);
+		}
+
+		s.done = sp.done();
+		return s;
+	}
+
+	// objects of the characteristics array from the full parse of body
+	static Split parse(const std::string& body)
+	{
+		Hap::Json::ParserStatic<64> js;
+		Split s;
+
+		if (!js.parse(body.data(), uint32_t(body.size())))
+			return s;
+
+		int arr = js.find(0, "characteristics");
+		if (arr < 0)
+			return s;
+		arr++;
+
+		for (int i = 0; i < js.size(arr); i++)
+		{
+			int e = js.find(arr, i);
+			s.elm.emplace_back(js.start(e), js.length(e));
+		}
+		s.done = true;
+
+		return s;
+	}
+
+	int json_test()
+	{
+		static const struct
+		{
+			const char* body;
+			bool valid;
+		} v[] =
+		{
+			// strings with structural chars and escaped quotes, nested value array,
+			//	arrays of other members and a key which is a prefix of the array key are skipped
+			{ "{\"pid\":\"characteristics\",\"char\":[{\"aid\":9}],\"characteristics\":["
+				"{\"aid\":1,\"iid\":9,\"value\":\"a{b]c\\\"}d\\\\\"},"
+				" {\"aid\":2,\"iid\":10,\"value\":[1,{\"x\":\"]\"},[2,3]]}\r\n,"
+				"{\"aid\":3,\"iid\":11,\"ev\":true}],\"pid\":11122333}", true },
+			{ "{\"characteristics\":[]}", true },
+			// missing root object
+			{ "\"characteristics\":[{\"aid\":1,\"iid\":9,\"value\":1}]", false },
+			// extra root object
+			{ "{\"characteristics\":[{\"aid\":1,\"iid\":9,\"value\":1}]}{\"characteristics\":[]}", false },
+			// incomplete root object
+			{ "{\"characteristics\":[{\"aid\":1,\"iid\":9,\"value\":1}]", false },
+			// no array
+			{ "{\"pid\":11122333}", false },
+		};
+
+		int r = 0;
+
+		LOG_MSG("Json test\n");
+
+		for (unsigned i = 0; i < sizeofarr(v); i++)
+		{
+			std::string body = v[i].body;
+			Split one = split(body, body.size());
+
+			if ((one.ok && one.done) != v[i].valid)
+			{
+				LOG_MSG("Json: body %d is %s\n", i, v[i].valid ? "rejected" : "accepted");
+				r++;
+				continue;
+			}
+
+			if (v[i].valid && !(one == parse(body)))
+			{
+				LOG_MSG("Json: body %d objects differ from parser\n", i);
+				r++;
+				continue;
+			}
+
+			for (size_t k = 0; k < body.size(); k++)
+			{
+				if (!(split(body, k) == one))
+				{
+					LOG_MSG("Json: body %d split at %d differs\n", i, int(k));
+					r++;
+					break;
+				}
+			}
+		}
+
+		return r;
+	}
+}
@@ -0,0 +1,61 @@
+/*
+	Copyright(c) 2020 Gera Kazakov
+	SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "CryptoTest/CryptoTest.h"
+
+namespace CryptoTest
+{
+	static bool is(const char* primitive, const char* kernel)
+	{
+		const char* k = Crypto::selected(primitive);
+		return k != nullptr && strcmp(k, kernel) == 0;
+	}
+
+	int select_test()
+	{
+		int r = 0;
+		uint32_t karMin = MD::karMin;
+		uint32_t karSqrMin = MD::karSqrMin;
+
+		LOG_MSG("Select test\n");
+
+		// forced kernels, unknown names are ignored
+		if (!Crypto::select("mul=school,sqr=kar16,sha512=none,md5=ref"))
+			r++;
+		if (!is("mul", "school") || MD::karMin != 0xFFFFFFFF)
+		{
+			LOG_MSG("Select: mul override not applied\n");
+			r++;
+		}
+		if (!is("sqr", "kar16") || MD::karSqrMin != 16)
+		{
+			LOG_MSG("Select: sqr override not applied\n");
+			r++;
+		}
+		if (!is("sha512", "ref") || Crypto::selected("md5") != nullptr)
+			r++;
+
+		// benchmark picks a correct kernel for every primitive
+		if (!Crypto::select())
+			r++;
+		if (Crypto::selected("mul") == nullptr || Crypto::selected("poly1305") == nullptr)
+			r++;
+
+		// kernels are not rebound under running crypto threads
+		const char* mul = Crypto::selected("mul");
+		Crypto::hold();
+		if (Crypto::select(strcmp(mul, "school") == 0 ? "mul=kar16" : "mul=school") || !is("mul", mul))
+		{
+			LOG_MSG("Select: kernels rebound while held\n");
+			r++;
+		}
+		Crypto::release();
+
+		MD::karMin = karMin;
+		MD::karSqrMin = karSqrMin;
+
+		return r;
+	}
+}
@@ -5,6 +5,7 @@
 
 #include "CryptoTest/CryptoTest.h"
 #include <chrono>
+#include <thread>
 
 namespace CryptoTest
 {
@@ -118,7 +119,8 @@ namespace CryptoTest
 
 		// 1: I, s, v are stored in password db on host
 		d1 = Timer::now();
-		static Srp::Verifier ver(I, p, s);
+		static Srp::Ctx ctx;
+		static Srp::Verifier ver(ctx, I, p, s);
 		if (memcmp(v, ver.v, sizeof(v)) != 0)
 		{
 			LOG_MSG("Verifier mismatch\n");
@@ -130,6 +132,7 @@ namespace CryptoTest
 		// 2: User: get name/password
 		d1 = Timer::now();
 		static Srp::User user(
+			ctx,
 			I,		// username	from user
 			p,		// password from user
 			a		// Private value in
@@ -145,10 +148,11 @@ namespace CryptoTest
 		// 3: User -> Host:  I, A
 		d1 = Timer::now();
 		static Srp::Host host(ver);
-		host.init(
+		bool init = host.init(
+			ctx,
 			b		// Private value in		host random value
 		);
-		if (memcmp(B, host.getB(), sizeof(B)) != 0)
+		if (!init || memcmp(B, host.getB(), sizeof(B)) != 0)
 		{
 			LOG_MSG("Host Public value B mismatch\n");
 			r++;
@@ -156,9 +160,17 @@ namespace CryptoTest
 		d2 = Timer::now();
 		LOG_MSG("SRP 3.1 duration: %lld\n", Timer::ms(d1, d2));
 
+		// precalculated ephemeral must give the same B
+		static Srp::Host::Ephemeral e;
+		static Srp::Host host2(ver);
+		if (!Srp::Host::calc(ctx, e, ver.s, ver.v, b) || !host2.init(e) || memcmp(B, host2.getB(), sizeof(B)) != 0)
+		{
+			LOG_MSG("Host precalculated B mismatch\n");
+			r++;
+		}
+
 		d1 = Timer::now();
-		host.setA(A);
-		if (memcmp(K, host.getK(), sizeof(K)) != 0)
+		if (!host.setA(ctx, A) || memcmp(K, host.getK(), sizeof(K)) != 0)
 		{
 			LOG_MSG("Host Session key K mismatch\n");
 			r++;
@@ -168,11 +180,12 @@ namespace CryptoTest
 
 		// 4: Host -> User:  s, B
 		d1 = Timer::now();
-		user.auth(
+		bool auth = user.auth(
+			ctx,
 			s,		// salt from host
 			B		// Public value from host
 		);
-		if (memcmp(K, user.getK(), sizeof(K)) != 0)
+		if (!auth || memcmp(K, user.getK(), sizeof(K)) != 0)
 		{
 			LOG_MSG("User Session key K mismatch\n");
 			r++;
@@ -204,6 +217,29 @@ namespace CryptoTest
 		d2 = Timer::now();
 		LOG_MSG("SRP 6 duration: %lld\n", Timer::ms(d1, d2));
 
+		// 7: Host calculations with separate contexts run in parallel
+		d1 = Timer::now();
+		bool ok[2] = { false, false };
+		auto run = [&](int i)
+		{
+			Srp::Ctx* c = new Srp::Ctx;
+			Srp::Host* h = new Srp::Host(ver);
+			ok[i] = h->init(*c, b) && h->setA(*c, A)
+				&& memcmp(B, h->getB(), sizeof(B)) == 0 && memcmp(K, h->getK(), sizeof(K)) == 0;
+			delete h;
+			delete c;
+		};
+		std::thread th0(run, 0), th1(run, 1);
+		th0.join();
+		th1.join();
+		if (!ok[0] || !ok[1])
+		{
+			LOG_MSG("Parallel Host calculation mismatch\n");
+			r++;
+		}
+		d2 = Timer::now();
+		LOG_MSG("SRP 7 duration: %lld\n", Timer::ms(d1, d2));
+
 		return r;
 	}
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #ifndef _HAP_BUFFER_H_
 #define _HAP_BUFFER_H_
 
+#include <initializer_list>
+
 namespace Hap
 {
 	// generic buffer (pointer/length pair)
@@ -53,6 +55,128 @@ namespace Hap
 		BufStatic() : Buf<T>(_b, s) {}
 	};
 
+
+	// pool of buffers in size classes
+	//	the owner supplies storage for each class, so the total footprint is fixed,
+	//	Get hands out the smallest free block that fits the requested size,
+	//	blocks are taken per request and returned when the request is done
+	//	the pool is not thread-safe, it is used from the network task only
+	class BufPool
+	{
+	public:
+		static constexpr uint8_t MaxClasses = 4;
+		static constexpr uint8_t MaxBlocks = 32;		// max blocks in one class
+
+		struct Class
+		{
+			char* mem;			// storage of count * size bytes
+			uint32_t size;		// block size
+			uint8_t count;		// number of blocks
+		};
+
+		// usage statistics of one class
+		struct Stat
+		{
+			uint32_t get = 0;	// blocks handed out
+			uint32_t miss = 0;	// class was the best fit but had no free block
+			uint8_t used = 0;	// blocks in use
+			uint8_t peak = 0;	// max blocks in use
+		};
+
+		// classes must be listed in order of increasing block size
+		BufPool(std::initializer_list<Class> cls)
+		{
+			for (auto& c : cls)
+			{
+				if (_cnt == MaxClasses || c.count > MaxBlocks)
+					break;
+				_cls[_cnt] = c;
+				_free[_cnt] = c.count == 32 ? 0xFFFFFFFF : (1u << c.count) - 1;
+				_cnt++;
+			}
+		}
+
+		// get free block of at least size bytes
+		//	returns false when no such block is available
+		bool Get(uint32_t size, Buf<char>& buf)
+		{
+			bool fit = false;
+			for (uint8_t i = 0; i < _cnt; i++)
+			{
+				if (_cls[i].size < size)
+					continue;
+
+				if (_free[i] == 0)
+				{
+					if (!fit)
+						_st[i].miss++;
+					fit = true;
+					continue;
+				}
+
+				uint8_t b = 0;
+				while (!(_free[i] & (1u << b)))
+					b++;
+				_free[i] &= ~(1u << b);
+
+				Stat& st = _st[i];
+				st.get++;
+				if (++st.used > st.peak)
+					st.peak = st.used;
+
+				buf.set(_cls[i].mem + b * _cls[i].size, _cls[i].size);
+				return true;
+			}
+
+			fail++;
+			return false;
+		}
+
+		// return block to the pool, buf is cleared
+		void Put(Buf<char>& buf)
+		{
+			for (uint8_t i = 0; i < _cnt; i++)
+			{
+				const Class& c = _cls[i];
+				if (buf.p() >= c.mem && buf.p() < c.mem + c.count * c.size)
+				{
+					_free[i] |= 1u << ((buf.p() - c.mem) / c.size);
+					_st[i].used--;
+					break;
+				}
+			}
+			buf.set(nullptr, 0);
+		}
+
+		// total size of pool storage
+		uint32_t footprint() const
+		{
+			uint32_t n = 0;
+			for (uint8_t i = 0; i < _cnt; i++)
+				n += _cls[i].size * _cls[i].count;
+			return n;
+		}
+
+		void log() const
+		{
+			Log::Msg("BufPool: %u bytes  fail %u\n", footprint(), fail);
+			for (uint8_t i = 0; i < _cnt; i++)
+			{
+				const Stat& st = _st[i];
+				Log::Msg("BufPool: %5u x %u  get %u  miss %u  used %u  peak %u\n",
+					_cls[i].size, _cls[i].count, st.get, st.miss, st.used, st.peak);
+			}
+		}
+
+		uint32_t fail = 0;		// requests not satisfied
+
+	private:
+		Class _cls[MaxClasses];
+		Stat _st[MaxClasses];
+		uint32_t _free[MaxClasses];		// free blocks bitmap
+		uint8_t _cnt = 0;
+	};
+
 }
 
 #endif /*_HAP_BUFFER_H_*/
\ No newline at end of file
@@ -19,12 +19,53 @@ namespace Hap
 		"categoryId",
 		"statusFlags",
 		"setupCode",
+		"srp",
 		"port",
+		"crypto",
 		"keys",
 		"pairings",
 		"db"
 	};
 
+	bool Config::_srp()
+	{
+		// v = g^x, x = H(s | H("Pair-Setup" | ":" | setupCode))
+		//	the Verifier and context are large, allocate them only for the time of calculation
+		Srp::Ctx* ctx = new Srp::Ctx;
+		Srp::Verifier* ver = new Srp::Verifier;
+
+		ver->I = Http::Username;
+		ver->p = setupCode;
+		srpValid = ver->initV(*ctx);
+
+		memcpy(srpSalt, ver->s, sizeof(srpSalt));
+		memcpy(srpVerifier, ver->v, sizeof(srpVerifier));
+
+		delete ver;
+		delete ctx;
+
+		if (!srpValid)
+		{
+			Log::Err("Config: SRP verifier calculation error\n");
+			return false;
+		}
+
+		Log::Msg("Config: new SRP salt and verifier\n");
+		return true;
+	}
+
+	void Config::_srpCheck(uint8_t check[SrpCheckBytes])
+	{
+		uint8_t h[Crypto::Sha512::HASH_SIZE_BYTES];
+		Crypto::Sha512 sha;
+
+		sha.update(srpSalt, sizeof(srpSalt));
+		sha.update(setupCode, uint32_t(strlen(setupCode)));
+		sha.fini(h);
+
+		memcpy(check, h, SrpCheckBytes);
+	}
+
 	uint8_t Pairings::Count(Controller::Perm perm)
 	{
 		uint8_t cnt = 0;
@@ -22,9 +22,14 @@ namespace Hap
 	constexpr uint8_t MaxPairings = 16;						// max number of pairings the accessory supports (5.10 Add pairing)
 	constexpr uint8_t MaxHttpSessions = 8;					// max HTTP sessions (6.2.3 TCP requirements)
 	constexpr uint8_t MaxHttpHeaders = 20;					// max number of HTTP headers in request
+	constexpr uint8_t MaxHttpRequests = 1;					// max number of HTTP requests processed at the same time (one network task)
 	constexpr uint8_t MaxHttpTlv = 10;						// max num of items in incoming TLV
+	constexpr uint8_t MaxHttpJson = 32;						// max num of JSON tokens in one characteristic of PUT request
 	constexpr uint16_t MaxHttpBlock = 1024;					// max size of encrypted data block (6.5.2 Session securiry)
 	constexpr uint16_t MaxHttpFrame = MaxHttpBlock + 2 + 16;// max size of encrypted HTTP frame (size + data + tag)
+	constexpr uint8_t MaxCryptoWorkers = 2;					// crypto worker threads serving pairing handlers
+	constexpr uint8_t MaxResumeSessions = 8;				// size of Pair Resume cache, one session per controller
+	constexpr uint16_t ResumeTimeout = 3600;				// Pair Resume session lifetime, seconds
 
 	constexpr uint16_t DefString = 64;		// default length of a string characteristic
 	constexpr uint16_t MaxString = 64;		// max string length
@@ -86,8 +91,12 @@ namespace Hap
 		uint8_t statusFlags;			// status flags
 
 		const char* setupCode;			// setupCode code XXX-XX-XXX
+		uint8_t srpSalt[Srp::SRP_SALT_BYTES];			// SRP salt, generated with setupCode
+		uint8_t srpVerifier[Srp::SRP_VERIFIER_BYTES];	// SRP verifier for setupCode
+		bool srpValid = false;			// salt and verifier are calculated, invalid ones are not saved
 		uint16_t port;					// TCP port of HAP service in net byte order
 		bool BCT;						// Bonjour Compatibility Test
+		const char* crypto;				// crypto kernels override "primitive=kernel,..." (Crypto::select), empty - benchmark
 
 		std::function<void()> Update;	// config update notification
 
@@ -123,7 +132,9 @@ namespace Hap
 			key_category,
 			key_status,
 			key_setup,
+			key_srp,
 			key_port,
+			key_crypto,
 			key_keys,
 			key_pairings,
 			key_db,
@@ -131,6 +142,15 @@ namespace Hap
 		};
 		static const char* key[key_max];
 
+		// generate new SRP salt and verifier for current setupCode
+		//	returns false if the verifier calculation failed
+		bool _srp();
+
+		// check value saved with salt and verifier, H(salt | setupCode) truncated to SrpCheckBytes
+		//	restored verifier is used only when setupCode is the same it was generated for
+		static constexpr unsigned SrpCheckBytes = 16;
+		void _srpCheck(uint8_t check[SrpCheckBytes]);
+
 		virtual void _default() = 0;
 		virtual void _reset() = 0;
 		virtual bool _restore() = 0;
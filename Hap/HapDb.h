@@ -104,15 +104,15 @@ namespace Hap
 
 	// this set of templates maps FormatId to:
 	//	- C type used for internal representation
-	//	- Read function to format the property to string
+	//	- Read function to write the property value to JSON writer
 	//	- Write function to convert JSON token to internal representation
 	template <FormatId> struct hap_type;
 	template<> struct hap_type<FormatId::Null>
 	{
 		using type = uint8_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "null");
+			w.null();
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -122,9 +122,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Bool>
 	{
 		using type = bool;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%s", v ? "true" : "false");
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -134,9 +134,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Uint8>
 	{
 		using type = uint8_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%u", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -146,9 +146,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Uint16>
 	{
 		using type = uint16_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%u", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -158,9 +158,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Uint32>
 	{
 		using type = uint32_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%u", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -170,9 +170,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Uint64>
 	{
 		using type = uint64_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%lu", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -182,9 +182,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Int>
 	{
 		using type = int32_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%d", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -194,9 +194,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::Float>
 	{
 		using type = double;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%lg", v);
+			w.val(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -206,9 +206,9 @@ namespace Hap
 	template<> struct hap_type<FormatId::ConstStr>
 	{
 		using type = const char *;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "\"%s\"", v);
+			w.str(v);
 		}
 		static inline bool Write(const Hap::Json::Obj& js, int t, type& v)
 		{
@@ -218,29 +218,25 @@ namespace Hap
 	template<> struct hap_type<FormatId::Format>
 	{
 		using type = FormatId;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "\"%s\"", FormatStr(v));
+			w.str(FormatStr(v));
 		}
 	};
 	template<> struct hap_type<FormatId::Unit>
 	{
 		using type = UnitId;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "\"%s\"", UnitStr(v));
+			w.str(UnitStr(v));
 		}
 	};
 	template<> struct hap_type<FormatId::String>
 	{
 		using type = char;
-		static inline int Read(char* str, uint32_t max, type v[], int _length)
+		static inline void Read(Hap::Json::Writer& w, type v[], int _length)
 		{
-			char* s = str;
-			int l = snprintf(s, max, "\"%.*s\"", _length, v);
-			s += l;
-
-			return (int)(s - str);
+			w.str(v, (int)strnlen(v, _length));
 		}
 	};
 	template<> struct hap_type<FormatId::Data>
@@ -250,43 +246,20 @@ namespace Hap
 	template<> struct hap_type<FormatId::Id>
 	{
 		using type = iid_t;
-		static inline int Read(char* s, uint32_t max, type v)
+		static inline void Read(Hap::Json::Writer& w, type v)
 		{
-			return snprintf(s, max, "%u", v);
+			w.val(v);
 		}
 	};
 	template<> struct hap_type<FormatId::IdArray>
 	{
 		using type = uint64_t;
-		static int Read(char* str, int max, type v[], int _length)
+		static void Read(Hap::Json::Writer& w, type v[], int _length)
 		{
-			char* s = str;
-			bool comma;
-
-			*s++ = '[';
-			max--;
-			if (max <= 0) goto Ret;
-
-			comma = false;
+			w.arr();
 			for (int i = 0; i < _length; i++)
-			{
-				if (comma)
-				{
-					*s++ = ',';
-					max--;
-					if (max <= 0) goto Ret;
-				}
-				int l = snprintf(s, max, "\"%ld\"", v[i]);
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				comma = true;
-			}
-
-			*s++ = ']';
-		Ret:
-			return (int)(s - str);
+				w.val(v[i]);
+			w.end_arr();
 		}
 	};
 
@@ -295,7 +268,8 @@ namespace Hap
 	//		getId - returns object id (aid or iid), or null_id
 	//		setId - sequentially sets object id, and all child ids; returns next available id
 	//		isType - return true if object has property Type and its value matches t
-	//		getDb - return JSON representation of Db object for GET/accessories request
+	//		getDb - write JSON representation of Db object for GET/accessories request
+	//		getEvents - write pending events of the session, nothing when there are no events
 	//		Write - write single characteristic
 	//				returns true when it completes write to characteristic, 
 	//					status of the operation is indicated in p.status
@@ -312,8 +286,8 @@ namespace Hap
 		virtual bool isType(const char* t) { return false; }
 		virtual void Open(sid_t sid) {}
 		virtual void Close(sid_t sid) {}
-		virtual int getDb(char* str, int max, sid_t sid) = 0;
-		virtual int getEvents(char* str, int max, sid_t sid, iid_t aid, iid_t iid) { return 0; }
+		virtual void getDb(Hap::Json::Writer& w, sid_t sid) = 0;
+		virtual void getEvents(Hap::Json::Writer& w, sid_t sid, iid_t aid, iid_t iid) {}
 
 		// parsed parameters of PUT/characteristics request
 		struct wr_prm
@@ -350,8 +324,7 @@ namespace Hap
 			bool type : 1;
 			bool ev : 1;
 
-			char* s;
-			int max;
+			Hap::Json::Writer* w = nullptr;	// members of the characteristic object are added to the response
 
 			Hap::Status status = Hap::Status::Success;
 		};
@@ -432,113 +405,41 @@ namespace Hap
 			return nullptr;
 		}
 
-		// getDb - create JSON representation of the array
-		int getDb(char* str, int max, sid_t sid, const char* name = nullptr) const
+		// getDb - write JSON representation of the array elements,
+		//	they are wrapped into array member <name> when the name is provided
+		void getDb(Hap::Json::Writer& w, sid_t sid, const char* name = nullptr) const
 		{
-			char* s = str;
-			int l;
-			bool comma;
-
-			if (max <= 0) goto Ret;
-
 			if (name != nullptr)
-			{
-				l = snprintf(s, max, "\"%s\":[", name);
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-			}
+				w.arr(name);
 
-			comma = false;
 			for (int i = 0; i < _sz; i++)
 			{
 				Obj* obj = _obj[i];
 				if (obj != nullptr)
-				{
-					if (comma)
-					{
-						*s++ = ',';
-						max--;
-						if (max <= 0) goto Ret;
-					}
-
-					l = obj->getDb(s, max, sid);
-					s += l;
-					max -= l;
-					if (max <= 0) goto Ret;
-					comma = true;
-				}
+					obj->getDb(w, sid);
 			}
 
 			if (name != nullptr)
-			{
-				*s++ = ']';
-				max--;
-				if (max <= 0) goto Ret;
-			}
-		Ret:
-			return (int)(s - str);
+				w.end_arr();
 		}
 
 		// getEvents
-		int getEvents(char* str, int max, sid_t sid, iid_t aid = 0, iid_t iid = 0, const char* name = nullptr) const
+		//	aid and iid identify the parent of array elements, 0 for accessories array
+		void getEvents(Hap::Json::Writer& w, sid_t sid, iid_t aid = 0, iid_t iid = 0) const
 		{
-			char* s = str;
-			int l;
-			bool comma;
-
-			if (max <= 0) goto Ret;
-
-			if (name != nullptr)
-			{
-				l = snprintf(s, max, "\"%s\":[", name);
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-			}
-
-			comma = false;
 			for (int i = 0; i < _sz; i++)
 			{
 				Obj* obj = _obj[i];
-				if (obj != nullptr)
-				{
-					if (comma)
-					{
-						*s++ = ',';
-						max--;
-						if (max <= 0) goto Ret;
-					}
-
-					if (aid == 0)		// accessories array
-						l = obj->getEvents(s, max, sid, obj->getId(), 0);
-					else if (iid == 0)	// services array
-						l = obj->getEvents(s, max, sid, aid, obj->getId());
-					else				// characteristics array
-						l = obj->getEvents(s, max, sid, aid, iid);
-					if (l > 0)
-					{
-						comma = true;
-						s += l;
-						max -= l;
-						if (max <= 0) goto Ret;
-					}
-					else if (comma)
-					{
-						s--;
-						max++;
-					}
-				}
-			}
+				if (obj == nullptr)
+					continue;
 
-			if (name != nullptr)
-			{
-				*s++ = ']';
-				max--;
-				if (max <= 0) goto Ret;
+				if (aid == 0)		// accessories array
+					obj->getEvents(w, sid, obj->getId(), 0);
+				else if (iid == 0)	// services array
+					obj->getEvents(w, sid, aid, obj->getId());
+				else				// characteristics array
+					obj->getEvents(w, sid, aid, iid);
 			}
-		Ret:
-			return (int)(s - str);
 		}
 	};
 	
@@ -590,23 +491,10 @@ namespace Hap
 			void set(T v) { _v = v; }
 
 			// get JSON-formatted characteristic descriptor
-			virtual int getDb(char* str, int max, sid_t sid) override
+			virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 			{
-				char* s = str;
-				int l;
-
-				if (max <= 0) goto Ret;
-
-				l = snprintf(s, max, "\"%s\":", key());
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				l = hap_type<Format>::Read(s, max, _v);
-				s += l;
-				max -= l;
-			Ret:
-				return (int)(s - str);
+				w.key(key());
+				hap_type<Format>::Read(w, _v);
 			}
 		};
 
@@ -657,24 +545,10 @@ namespace Hap
 			}
 
 			// get JSON-formatted characteristic descriptor
-			virtual int getDb(char* str, int max) override
+			virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 			{
-				char*s = str;
-				int l;
-					
-				if (max <= 0) goto Ret;
-
-				l = snprintf(s, max, "\"%s\":", key());
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				l = hap_type<Format>::getDb(s, max, _v, _length);
-				s += l;
-				max -= l;
-
-			Ret:
-				return s - str;
+				w.key(key());
+				hap_type<Format>::Read(w, _v, _length);
 			}
 		};
 
@@ -708,47 +582,20 @@ namespace Hap
 				return (get() & p) != 0;
 			}
 
-			virtual int getDb(char* str, int max, sid_t sid) override
+			virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 			{
 				static const char* PermStr[] =
 				{
 					"pr", "pw", "ev", "aa", "tw", "hd", "wr"
 				};
-				char* s = str;
-				bool comma;
-				int l;
 
-				if (max <= 0) goto Ret;
-
-				l = snprintf(s, max, "\"%s\":[", key());
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				comma = false;
+				w.arr(key());
 				for (int i = 0; i < 5; i++)
 				{
 					if (isEnabled(Perm(1 << i)))
-					{
-						if (comma)
-						{
-							*s++ = ',';
-							max--;
-							if (max <= 0) goto Ret;
-						}
-
-						l = snprintf(s, max, "\"%s\"", PermStr[i]);
-						s += l;
-						max -= l;
-						if (max <= 0) goto Ret;
-
-						comma = true;
-					}
+						w.str(PermStr[i]);
 				}
-
-				*s++ = ']';
-			Ret:
-				return (int)(s - str);
+				w.end_arr();
 			}
 		};
 
@@ -796,23 +643,10 @@ namespace Hap
 			}
 
 			// get JSON-formatted characteristic descriptor
-			virtual int getDb(char* str, int max, sid_t sid) override
+			virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 			{
-				char* s = str;
-				int l;
-
-				if (max <= 0) goto Ret;
-
-				l = snprintf(s, max, "\"%s\":", key());
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				l = hap_type<FormatId::Bool>::Read(s, max, _v[sid]);
-				s += l;
-				max -= l;
-			Ret:
-				return (int)(s - str);
+				w.key(key());
+				hap_type<FormatId::Bool>::Read(w, _v[sid]);
 			}
 		};
 
@@ -899,25 +733,11 @@ namespace Hap
 			}
 
 			// get JSON-formatted characteristic descriptor
-			virtual int getDb(char* str, int max, sid_t sid) override
+			virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 			{
-				char* s = str;
-				int l;
-
-				if (max <= 0) goto Ret;
-
-				*s++ = '{';
-				max--;
-				if (max <= 0) goto Ret;
-
-				l = _prop.getDb(s, max, sid);
-				s += l;
-				max -= l;
-				if (max <= 0) goto Ret;
-
-				*s++ = '}';
-			Ret:
-				return (int)(s - str);
+				w.obj();
+				_prop.getDb(w, sid);
+				w.end_obj();
 			}
 
 			// access to common properties
@@ -989,32 +809,16 @@ namespace Hap
 			void onRead(OnRead h) { _onRead = h; }
 			void onWrite(OnWrite<V> h) { _onWrite = h; }
 
-			virtual int getEvents(char* str, int max, sid_t sid, iid_t aid, iid_t iid) override
+			virtual void getEvents(Hap::Json::Writer& w, sid_t sid, iid_t aid, iid_t iid) override
 			{
-				char* s = str;
-				int l;
-
-				if (max <= 0) goto Ret;
-
-				if (B::GetAndClearEvent(sid))
-				{
-					*s++ = '{';
-					max--;
-					if (max <= 0) goto Ret;
-
-					l = snprintf(s, max, "\"aid\":%d,\"iid\":%d,", aid, B::Iid().get());
-					s += l;
-					max -= l;
-					if (max <= 0) goto Ret;
-
-					l = _value.getDb(s, max, sid);
-					s += l;
-					max -= l;
-
-					*s++ = '}';
-				}
-			Ret:
-				return (int)(s - str);
+				if (!B::GetAndClearEvent(sid))
+					return;
+
+				w.obj();
+				w.key("aid").val(aid);
+				w.key("iid").val(B::Iid().get());
+				_value.getDb(w, sid);
+				w.end_obj();
 			}
 
 			virtual bool Write(Obj::wr_prm& p, sid_t sid) override
@@ -1087,7 +891,7 @@ namespace Hap
 					return false;
 				}
 
-				int l;
+				Hap::Json::Writer& w = *p.w;
 
 				// add value
 				if (!B::Perms().isEnabled(Property::Permissions::PairedRead))
@@ -1105,134 +909,35 @@ namespace Hap
 							return true;
 					}
 
-					*p.s++ = ',';
-					p.max--;
-					if (p.max <= 0) return true;
-
-					l = _value.getDb(p.s, p.max, sid);
-					p.s += l;
-					p.max -= l;
-					if (p.max <= 0)	return true;
+					_value.getDb(w, sid);
 				}
 
-				Obj* prop;
-
 				// add meta
 				if (p.meta)
 				{
-					*p.s++ = ',';
-					p.max--;
-					if (p.max <= 0) return true;
-
-					l = B::Format().getDb(p.s, p.max, sid);
-					p.s += l;
-					p.max -= l;
-					if (p.max <= 0)	return true;
-
-					prop = B::GetProperty(KeyId::unit);
-					if (prop != nullptr)
-					{
-						*p.s++ = ',';
-						p.max--;
-						if (p.max <= 0) return true;
-
-						l = prop->getDb(p.s, p.max, sid);
-						p.s += l;
-						p.max -= l;
-						if (p.max <= 0)	return true;
-					}
-
-					prop = B::GetProperty(KeyId::minValue);
-					if (prop != nullptr)
-					{
-						*p.s++ = ',';
-						p.max--;
-						if (p.max <= 0) return true;
-
-						l = prop->getDb(p.s, p.max, sid);
-						p.s += l;
-						p.max -= l;
-						if (p.max <= 0)	return true;
-					}
+					static const KeyId meta[] = { KeyId::unit, KeyId::minValue, KeyId::maxValue, KeyId::minStep, KeyId::maxLen };
 
-					prop = B::GetProperty(KeyId::maxValue);
-					if (prop != nullptr)
-					{
-						*p.s++ = ',';
-						p.max--;
-						if (p.max <= 0) return true;
-
-						l = prop->getDb(p.s, p.max, sid);
-						p.s += l;
-						p.max -= l;
-						if (p.max <= 0)	return true;
-					}
+					B::Format().getDb(w, sid);
 
-					prop = B::GetProperty(KeyId::minStep);
-					if (prop != nullptr)
+					for (auto key : meta)
 					{
-						*p.s++ = ',';
-						p.max--;
-						if (p.max <= 0) return true;
-
-						l = prop->getDb(p.s, p.max, sid);
-						p.s += l;
-						p.max -= l;
-						if (p.max <= 0)	return true;
-					}
-
-					prop = B::GetProperty(KeyId::maxLen);
-					if (prop != nullptr)
-					{
-						*p.s++ = ',';
-						p.max--;
-						if (p.max <= 0) return true;
-
-						l = prop->getDb(p.s, p.max, sid);
-						p.s += l;
-						p.max -= l;
-						if (p.max <= 0)	return true;
+						Obj* prop = B::GetProperty(key);
+						if (prop != nullptr)
+							prop->getDb(w, sid);
 					}
 				}
 
 				// add perms
 				if (p.perms)
-				{
-					*p.s++ = ',';
-					p.max--;
-					if (p.max <= 0) return true;
-
-					l = B::Perms().getDb(p.s, p.max, sid);
-					p.s += l;
-					p.max -= l;
-					if (p.max <= 0)	return true;
-				}
+					B::Perms().getDb(w, sid);
 
 				// add type
 				if (p.type)
-				{
-					*p.s++ = ',';
-					p.max--;
-					if (p.max <= 0) return true;
-
-					l = B::Type().getDb(p.s, p.max, sid);
-					p.s += l;
-					p.max -= l;
-					if (p.max <= 0)	return true;
-				}
+					B::Type().getDb(w, sid);
 
 				// add ev
 				if (p.ev)
-				{
-					*p.s++ = ',';
-					p.max--;
-					if (p.max <= 0) return true;
-
-					l = B::EventNotifications().getDb(p.s, p.max, sid);
-					p.s += l;
-					p.max -= l;
-					if (p.max <= 0)	return true;
-				}
+					B::EventNotifications().getDb(w, sid);
 
 				return true;	// true indicates that characteristic was found
 			}
@@ -1357,48 +1062,17 @@ namespace Hap
 			return strcmp(t, _type.get()) == 0;
 		}
 
-		virtual int getDb(char* str, int max, sid_t sid) override
+		virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 		{
-			char* s = str;
-			int l;
-
-			if (max <= 0) goto Ret;
-
-			*s++ = '{';
-			max--;
-			if (max <= 0) goto Ret;
-
-			l = _prop.getDb(s, max, sid);
-			s += l;
-			max -= l;
-			if (max <= 0) goto Ret;
-
-			*s++ = ',';
-			max--;
-			if (max <= 0) goto Ret;
-
-			l = _char.getDb(s, max, sid, "characteristics");
-			s += l;
-			max -= l;
-			if (max <= 0) goto Ret;
-
-			*s++ = '}';
-		Ret:
-			return (int)(s - str);
+			w.obj();
+			_prop.getDb(w, sid);
+			_char.getDb(w, sid, "characteristics");
+			w.end_obj();
 		}
 
-		virtual int getEvents(char* str, int max, sid_t sid, iid_t aid, iid_t iid) override
+		virtual void getEvents(Hap::Json::Writer& w, sid_t sid, iid_t aid, iid_t iid) override
 		{
-			char* s = str;
-			int l;
-
-			if (max <= 0) goto Ret;
-
-			l = _char.getEvents(s, max, sid, aid, iid);
-			s += l;
-			max -= l;
-		Ret:
-			return (int)(s - str);
+			_char.getEvents(w, sid, aid, iid);
 		}
 
 		virtual bool Write(wr_prm& p, sid_t sid) override
@@ -1505,48 +1179,17 @@ namespace Hap
 			}
 		}
 
-		virtual int getDb(char* str, int max, sid_t sid) override
+		virtual void getDb(Hap::Json::Writer& w, sid_t sid) override
 		{
-			char* s = str;
-			int l;
-
-			if (max <= 0) goto Ret;
-
-			*s++ = '{';
-			max--;
-			if (max <= 0) goto Ret;
-
-			l = _prop.getDb(s, max, sid);
-			s += l;
-			max -= l;
-			if (max <= 0) goto Ret;
-
-			*s++ = ',';
-			max--;
-			if (max <= 0) goto Ret;
-
-			l = _serv.getDb(s, max, sid, "services");
-			s += l;
-			max -= l;
-			if (max <= 0) goto Ret;
-
-			*s++ = '}';
-		Ret:
-			return (uint32_t)(s - str);
+			w.obj();
+			_prop.getDb(w, sid);
+			_serv.getDb(w, sid, "services");
+			w.end_obj();
 		}
 
-		virtual int getEvents(char* str, int max, sid_t sid, iid_t aid, iid_t iid) override
+		virtual void getEvents(Hap::Json::Writer& w, sid_t sid, iid_t aid, iid_t iid) override
 		{
-			char* s = str;
-			int l;
-
-			if (max <= 0) goto Ret;
-
-			l = _serv.getEvents(s, max, sid, aid, iid);
-			s += l;
-			max -= l;
-		Ret:
-			return (uint32_t)(s - str);
+			_serv.getEvents(w, sid, aid, iid);
 		}
 
 		virtual bool Write(wr_prm& p, sid_t sid) override
@@ -1637,78 +1280,152 @@ namespace Hap
 		}
 
 		// get JSON-formatted database
-		//	returns num of charactes written to str (up to max)
-		int getDb(sid_t sid, char* str, int max)
+		//	the data is written to w, it passes the data to its spill callback when its buffer is full
+		void getDb(sid_t sid, Hap::Json::Writer& w)
 		{
-			char* s = str;
-			int l;
+			w.obj();
+			_acc.getDb(w, sid, "accessories");
+			w.end_obj();
+		}
 
-			if (max <= 0) goto Ret;
+		// collect events
+		//	returns HTTP status and JSON-formatted body for HTTP EVENT,
+		//	nothing is written to w when there are no events
+		Http::Status getEvents(sid_t sid, Hap::Json::Writer& w)
+		{
+			w.obj().arr("characteristics");
+			uint32_t len = w.total();
 
-			*s++ = '{';
-			max--;
-			if (max <= 0) goto Ret;
+			_acc.getEvents(w, sid);
+			if (w.total() == len)
+			{
+				w.reset();
+				return Http::Status::HTTP_200;
+			}
 
-			l = _acc.getDb(s, max, sid, "accessories");
-			s += l;
-			max -= l;
+			w.end_arr().end_obj();
+			if (!w.ok())
+			{
+				w.reset();
+				return Http::Status::HTTP_500;	// Internal error
+			}
 
-			*s++ = '}';
-		Ret:
-			return (int)(s - str);
+			return Http::Status::HTTP_200;
 		}
 
-		// collect events
-		//	returns HTTP status and JSON-formatted body for HTTP EVENT
-		//	the rsp_size must be initially set to size of the rsp buffer;
-		//	on return in contains size of the response object, if any 
-		Http::Status getEvents(sid_t sid, char* rsp, int& rsp_size)
+		// exec one characteristic write of PUT/characteristics request
+		//	c - index of the characteristic object in parsed request
+		//	returns false when the object is invalid,
+		//	otherwise p contains aid, iid and status of the write
+		bool Write(sid_t sid, Hap::Json::Parser& wr, int c, Obj::wr_prm& p)
 		{
-			char* s = rsp;
-			int l, max = rsp_size;
+			if (wr.tk(c) == nullptr || wr.tk(c)->type != Hap::Json::JSMN_OBJECT)
+			{
+				Log::Err("Characteristic: Object expected\n");
+				return false;
+			}
 
-			rsp_size = 0;
+			// parse characteristic object
+			Hap::Json::member om[] =
+			{
+				{ "aid", Hap::Json::JSMN_PRIMITIVE },
+				{ "iid", Hap::Json::JSMN_PRIMITIVE },
+				{ "value", Hap::Json::JSMN_ANY | Hap::Json::JSMN_UNDEFINED },
+				{ "ev", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
+				{ "authData", Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
+				{ "remote", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
+				{ "r", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
+			};
 
-			l = snprintf(s, max, "{\"characteristics\":[");
-			s += l;
-			max -= l;
-			if (max <= 0)
-				return Http::Status::HTTP_500;	// Internal error
+			int rc = wr.parse(c, om, sizeofarr(om));
+			if (rc >= 0)
+			{
+				Log::Err("Characteristic: parameter '%s' is missing or invalid", om[rc].key);
+				return false;
+			}
 
-			l = _acc.getEvents(s, max, sid);
-			if (l == 0)
+			// aid
+			if (!wr.set_if(om[0].i, p.aid))
 			{
-				rsp_size = 0;
-				return Http::Status::HTTP_200;
+				Log::Err("Characteristic: invalid aid\n");
+				return false;
 			}
-			s += l;
-			max -= l;
-			if (max <= 0)
-				return Http::Status::HTTP_500;	// Internal error
 
-			l = snprintf(s, max, "]}");
-			s += l;
-			max -= l;
-			if (max <= 0)
-				return Http::Status::HTTP_500;	// Internal error
+			// iid
+			if (!wr.set_if(om[1].i, p.iid))
+			{
+				Log::Err("Characteristic: invalid iid\n");
+				return false;
+			}
 
-			rsp_size = (int)(s - rsp);
+			// value
+			if (om[2].i > 0)
+			{
+				p.val_present = true;
+				p.val_ind = om[2].i;
+			}
 
-			return Http::Status::HTTP_200;
+			// ev
+			if (om[3].i > 0)
+			{
+				p.ev_present = wr.set_if(om[3].i, p.ev_value);
+			}
+
+			// authData
+			if (om[4].i > 0)
+			{
+				p.auth_present = true;
+				p.auth_ind = om[4].i;
+			}
+
+			// remote
+			if (om[5].i > 0)
+			{
+				p.remote_present = wr.set_if(om[5].i, p.remote_value);
+			}
+
+			// r	(Response)
+			if (om[6].i > 0)
+			{
+				p.response_present = wr.set_if(om[6].i, p.response_value);
+			}
+
+			Log::Msg("Characteristic:  aid %u  iid %u\n", p.aid, p.iid);
+			if (p.val_present)
+				Log::Msg("      value: '%.*s'\n", wr.length(p.val_ind), wr.start(p.val_ind));
+			if (p.ev_present)
+				Log::Msg("         ev: %s\n", p.ev_value ? "true" : "false");
+			if (p.auth_present)
+				Log::Msg("   authData: '%.*s'\n", wr.length(p.auth_ind), wr.start(p.auth_ind));
+			if (p.remote_present)
+				Log::Msg("     remote: %s\n", p.remote_value ? "true" : "false");
+			if (p.response_present)
+				Log::Msg("   response: %s\n", p.response_value ? "true" : "false");
+
+			// find accessory by aid
+			auto acc = GetAcc(p.aid);
+			if (acc == nullptr)
+			{
+				p.status = Hap::Status::ResourceNotExist;
+			}
+			else
+			{
+				if (!acc->Write(p, sid))
+					p.status = Hap::Status::ResourceNotExist;
+			}
+
+			// TODO: add value if 'r' key is present
+			return true;
 		}
 
 		// exec PUT/characteristics request
 		//	accepts JSON-formatted message body of parsed HTTP request
-		//	returns HTTP status and JSON-formatted body for HTTP response
-		//	the rsp_size must be initially set to size of the rsp buffer;
-		//	on return in contains size of the response object, if any 
-		Http::Status Write(sid_t sid, Hap::Json::Parser& wr, char* rsp, int& rsp_size)
+		//	returns HTTP status, JSON-formatted body for HTTP response is written to w,
+		//	nothing is written when the response has no body
+		Http::Status Write(sid_t sid, Hap::Json::Parser& wr, Hap::Json::Writer& w)
 		{
-			int l, max = rsp_size;
 			int rc;
 
-			rsp_size = 0;
-
 			// parse root object
 			Hap::Json::member om[] =
 			{
@@ -1725,15 +1442,9 @@ namespace Hap
 			Log::Msg("Request contains %d characteristics\n", cnt);
 
 			// prepare response
-			char* s = rsp;
-			bool comma = false;
 			int errcnt = 0;
 
-			l = snprintf(s, max, "{\"characteristics\":[");
-			s += l;
-			max -= l;
-			if (max <= 0)
-				return Http::Status::HTTP_500;	// Internal error
+			w.obj().arr("characteristics");
 
 			// parse and execute individual writes
 			for (int i = 0; i < cnt; i++)
@@ -1743,143 +1454,42 @@ namespace Hap
 				if (c < 0)
 				{
 					Log::Err("Characteristic %d not found\n", i);
+					w.reset();
 					return Http::Status::HTTP_400;
 				}
 
-				if (wr.tk(c)->type != Hap::Json::JSMN_OBJECT)
-				{
-					Log::Err("Characteristic %d: Object expected\n", i);
-					return Http::Status::HTTP_400;
-				}
-
-				// parse characteristic object
-				Hap::Json::member om[] =
-				{
-					{ "aid", Hap::Json::JSMN_PRIMITIVE },
-					{ "iid", Hap::Json::JSMN_PRIMITIVE },
-					{ "value", Hap::Json::JSMN_ANY | Hap::Json::JSMN_UNDEFINED },
-					{ "ev", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
-					{ "authData", Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
-					{ "remote", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
-					{ "r", Hap::Json::JSMN_PRIMITIVE | Hap::Json::JSMN_UNDEFINED },
-				};
-
-				rc = wr.parse(c, om, sizeofarr(om));
-				if (rc >= 0)
-				{
-					Log::Err("Characteristic %d: parameter '%s' is missing or invalid", i, om[rc].key);
-					return Http::Status::HTTP_400;
-				}
-
-				// fill write request parameters and status
 				Obj::wr_prm p = { wr };
 
-				// aid
-				if (!wr.set_if(om[0].i, p.aid))
+				if (!Write(sid, wr, c, p))
 				{
-					Log::Err("Characteristic %d: invalid aid\n", i);
+					w.reset();
 					return Http::Status::HTTP_400;
 				}
 
-				// iid
-				if (!wr.set_if(om[1].i, p.iid))
-				{
-					Log::Err("Characteristic %d: invalid iid\n", i);
-					return Http::Status::HTTP_400;
-				}
-
-				// value
-				if (om[2].i > 0)
-				{
-					p.val_present = true;
-					p.val_ind = om[2].i;
-				}
-
-				// ev
-				if (om[3].i > 0)
-				{
-					p.ev_present = wr.set_if(om[3].i, p.ev_value);
-				}
-
-				// authData
-				if (om[4].i > 0)
-				{
-					p.auth_present = true;
-					p.auth_ind = om[4].i;
-				}
-
-				// remote
-				if (om[5].i > 0)
-				{
-					p.remote_present = wr.set_if(om[5].i, p.remote_value);
-				}
-
-				// r	(Response)
-				if (om[6].i > 0)
-				{
-					p.response_present = wr.set_if(om[6].i, p.response_value);
-				}
-
-				Log::Msg("Characteristic %d:  aid %u  iid %u\n", i, p.aid, p.iid);
-				if (p.val_present)
-					Log::Msg("      value: '%.*s'\n", wr.length(p.val_ind), wr.start(p.val_ind));
-				if (p.ev_present)
-					Log::Msg("         ev: %s\n", p.ev_value ? "true" : "false");
-				if (p.auth_present)
-					Log::Msg("   authData: '%.*s'\n", wr.length(p.auth_ind), wr.start(p.auth_ind));
-				if (p.remote_present)
-					Log::Msg("     remote: %s\n", p.remote_value ? "true" : "false");
-				if (p.response_present)
-					Log::Msg("   response: %s\n", p.response_value ? "true" : "false");
-
-				// find accessory by aid
-				auto acc = GetAcc(p.aid);
-				if (acc == nullptr)
-				{
-					p.status = Hap::Status::ResourceNotExist;
-				}
-				else
-				{
-					if (!acc->Write(p, sid))
-						p.status = Hap::Status::ResourceNotExist;
-				}
-
 				if (p.status != Hap::Status::Success)
 					errcnt++;
 
-				if (comma)
-				{
-					*s++ = ',';
-					max--;
-					if (max <= 0)
-						return Http::Status::HTTP_500;	// Internal error
-				}
-
-				l = snprintf(s, max, "{\"aid\":%d,\"iid\":%d,\"status\":%s}",
-					p.aid, p.iid, StatusStr(p.status));
-				s += l;
-				max -= l;
-				if (max <= 0)
-					return Http::Status::HTTP_500;	// Internal error
-				// TODO: add value if 'r' key is present
-				comma = true;
-
+				w.obj();
+				w.key("aid").val(p.aid);
+				w.key("iid").val(p.iid);
+				w.key("status").lit(StatusStr(p.status));
+				w.end_obj();
 			}
 
-			l = snprintf(s, max, "]}");
-			s += l;
-			max -= l;
-			if (max <= 0)
+			w.end_arr().end_obj();
+
+			if (!w.ok())
+			{
+				w.reset();
 				return Http::Status::HTTP_500;	// Internal error
+			}
 
 			if (errcnt == 0)
 			{
-				rsp_size = 0;
+				w.reset();
 				return Http::Status::HTTP_204;	// No content
 			}
 
-			rsp_size = (int)(s - rsp);
-
 			if (cnt == errcnt)		// all writes completed with error
 				return Http::Status::HTTP_400;	// bad request
 
@@ -1888,19 +1498,17 @@ namespace Hap
 		
 		// exec GET/characteristics request
 		//	accepts query string of parsed HTTP request (excluding '?' char)
-		//	returns HTTP status and JSON-formatted body for HTTP response
-		//	the rsp_size must be initially set to size of the rsp buffer;
-		//	on return in contains size of the response object, if any 
-		Http::Status Read(sid_t sid, const char* req, int req_length, char* rsp, int& rsp_size)
+		//	returns HTTP status, JSON-formatted body for HTTP response is written to w,
+		//	nothing is written when the response has no body
+		Http::Status Read(sid_t sid, const char* req, int req_length, Hap::Json::Writer& w)
 		{
 			Obj::rd_prm p;
 			const char* r = req;
 			int l = req_length;
-			int max = rsp_size;
 			const char* id = nullptr;
 			int id_length = 0;
 			
-			rsp_size = 0;
+			p.w = &w;
 			p.meta = p.perms = p.type = p.ev = false;
 
 			while (l > 0)
@@ -2017,15 +1625,10 @@ namespace Hap
 				return Http::Status::HTTP_400;	// id must present
 
 			// prepare response
-			char* s = rsp;
 			int acccnt = 0;
 			int errcnt = 0;
 
-			l = snprintf(s, max, "{\"characteristics\":[");
-			s += l;
-			max -= l;
-			if (max <= 0) return Http::Status::HTTP_500;
-
+			w.obj().arr("characteristics");
 
 			// parse id list and call read on each characteristic
 			bool read_aid = true;
@@ -2041,7 +1644,10 @@ namespace Hap
 						continue;
 					}
 					else if (*id++ != '.')
+					{
+						w.reset();
 						return Http::Status::HTTP_400;
+					}
 
 					id_length--;
 					read_aid = false;
@@ -2057,27 +1663,19 @@ namespace Hap
 							continue;
 					}
 					else if (id_length > 0 && *id++ != ',')
+					{
+						w.reset();
 						return Http::Status::HTTP_400;
+					}
 
 					id_length--;
 					read_aid = true;
 
 					Log::Msg("Read: aid %d iid %d\n", p.aid, p.iid);
 
-					if (acccnt > 0)
-					{
-						*s++ = ',';
-						max--;
-						if (max <= 0) return Http::Status::HTTP_500;
-					}
-
-					l = snprintf(s, max, "{\"aid\":%d,\"iid\":%d", p.aid, p.iid);
-					s += l;
-					max -= l;
-					if (max <= 0) return Http::Status::HTTP_500;
-
-					p.s = s;
-					p.max = max;
+					w.obj();
+					w.key("aid").val(p.aid);
+					w.key("iid").val(p.iid);
 
 					// find accessory by aid
 					auto acc = GetAcc(p.aid);
@@ -2091,29 +1689,12 @@ namespace Hap
 							p.status = Hap::Status::ResourceNotExist;
 					}
 
-					s = p.s;
-					max = p.max;
-					if (max <= 0) return Http::Status::HTTP_500;
-
 					if (p.status != Hap::Status::Success)
 					{
 						errcnt++;
-
-						*s++ = ',';
-						max--;
-						if (max <= 0) return Http::Status::HTTP_500;
-
-						l = snprintf(s, max, "\"status\":%s}", StatusStr(p.status));
-						s += l;
-						max -= l;
-						if (max <= 0) return Http::Status::HTTP_500;
-					}
-					else
-					{
-						*s++ = '}';
-						max--;
-						if (max <= 0) return Http::Status::HTTP_500;
+						w.key("status").lit(StatusStr(p.status));
 					}
+					w.end_obj();
 
 					acccnt++;
 
@@ -2122,13 +1703,13 @@ namespace Hap
 				}
 			}
 
-			l = snprintf(s, max, "]}");
-			s += l;
-			max -= l;
-			if (max <= 0)
-				return Http::Status::HTTP_500;	// Internal error
+			w.end_arr().end_obj();
 
-			rsp_size = (int)(s - rsp);
+			if (!w.ok())
+			{
+				w.reset();
+				return Http::Status::HTTP_500;	// Internal error
+			}
 
 			if (errcnt == 0)
 				return Http::Status::HTTP_200;	// OK
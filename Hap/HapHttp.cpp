@@ -5,6 +5,10 @@
 
 #include "Hap.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace Hap::Http
 {
 
@@ -13,9 +17,503 @@ namespace Hap::Http
 	const char* Username = "Pair-Setup";
 
 	// current pairing session - only one simultaneous pairing is allowed
-	Srp::Verifier ver;					// SRP verifier  //TODO: pre-calculate and store in config data
+	Srp::Ctx srpCtx;					// SRP calculation context
+	Srp::Verifier ver;					// SRP verifier, restored from config data
 	Srp::Host srp(ver);					// .active()=true - pairing in progress, only one pairing at a time
 	uint8_t srp_auth_count = 0;			// auth attempts counter
+	uint8_t srpA[Srp::SRP_PUBLIC_BYTES];	// M3: iOS public key
+	uint8_t srpM[Srp::SRP_PROOF_BYTES];		// M3: iOS proof
+	bool srpVerified = false;				// M3: iOS proof verified
+
+	// SRP ephemeral (b, B) precalculation
+	//	B = kv + g^b does not depend on controller input, so the next pair
+	//	is calculated in background and M1 is answered without exponentiation
+	class SrpPrecalc
+	{
+	public:
+		void Start()
+		{
+			Crypto::hold();
+			_running = true;
+			_task = std::thread(&SrpPrecalc::run, this);
+		}
+
+		void Stop()
+		{
+			if (!_task.joinable())
+				return;
+
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_running = false;
+			}
+			_cv.notify_one();
+			_task.join();
+			Crypto::release();
+		}
+
+		// request calculation of the next pair for verifier v with salt s
+		void Request(const uint8_t* s, const uint8_t* v)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				memcpy(_s, s, sizeof(_s));
+				memcpy(_v, v, sizeof(_v));
+				_request = true;
+				_ready = false;
+			}
+			_cv.notify_one();
+		}
+
+		// take calculated pair
+		//	returns false when the pair is not ready yet
+		bool Take(Srp::Host::Ephemeral& e)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			if (!_ready)
+				return false;
+			memcpy(&e, &_e, sizeof(e));
+			_ready = false;
+			return true;
+		}
+
+	private:
+		std::thread _task;
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		bool _running = false;
+		bool _request = false;					// new calculation requested
+		bool _ready = false;					// _e is valid
+		uint8_t _s[Srp::SRP_SALT_BYTES];		// request: verifier salt
+		uint8_t _v[Srp::SRP_VERIFIER_BYTES];	// request: verifier
+		Srp::Host::Ephemeral _e;				// result
+		Srp::Ctx _ctx;							// calculation context of the background task
+
+		void run()
+		{
+			Log::Msg("SrpPrecalc::Run - enter\n");
+
+			Srp::Host::Ephemeral e;
+			uint8_t s[Srp::SRP_SALT_BYTES];
+			uint8_t v[Srp::SRP_VERIFIER_BYTES];
+
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(_mtx);
+					_cv.wait(lock, [this] { return !_running || _request; });
+					if (!_running)
+						break;
+					memcpy(s, _s, sizeof(s));
+					memcpy(v, _v, sizeof(v));
+					_request = false;
+				}
+
+				if (!Srp::Host::calc(_ctx, e, s, v))
+				{
+					Log::Err("SrpPrecalc: B calculation error\n");
+					continue;
+				}
+
+				{
+					std::unique_lock<std::mutex> lock(_mtx);
+					if (_request)
+						continue;	// inputs changed during calculation
+					memcpy(&_e, &e, sizeof(_e));
+					_ready = true;
+				}
+			}
+
+			Log::Msg("SrpPrecalc::Run - exit\n");
+		}
+	} srpPrecalc;
+
+	// crypto worker pool
+	//	pairing handlers submit SRP, Curve25519, Ed25519 and HKDF calculations here,
+	//	the session is parked until completion so other sessions are served meanwhile
+	class CryptoPool
+	{
+	public:
+		using Work = std::function<void(Srp::Ctx& ctx)>;
+
+		void Start(Server::Wake wake)
+		{
+			Crypto::hold();
+			_wake = wake;
+			_running = true;
+			for (unsigned i = 0; i < sizeofarr(_task); i++)
+				_task[i] = std::thread(&CryptoPool::run, this, i);
+		}
+
+		void Stop()
+		{
+			if (!_task[0].joinable())
+				return;
+
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_running = false;
+			}
+			_cv.notify_all();
+			for (unsigned i = 0; i < sizeofarr(_task); i++)
+			{
+				if (_task[i].joinable())
+					_task[i].join();
+			}
+			Crypto::release();
+		}
+
+		// queue work for session sid
+		//	returns false when the pool is not running, the caller executes the work itself
+		bool Submit(sid_t sid, Work work)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				if (!_running)
+					return false;
+				_work[sid] = work;
+				_state[sid] = Queued;
+				_queue[_tail++ % sizeofarr(_queue)] = sid;
+			}
+			_cv.notify_one();
+			return true;
+		}
+
+		// returns true when work of session sid is complete
+		bool Ready(sid_t sid)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			return _state[sid] == Complete;
+		}
+
+		// consume completion of session sid work
+		void Done(sid_t sid)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			_state[sid] = Idle;
+		}
+
+		// wait for completion of session sid work, if any
+		void Wait(sid_t sid)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			_cv.wait(lock, [this, sid] { return _state[sid] == Idle || _state[sid] == Complete; });
+			_state[sid] = Idle;
+		}
+
+	private:
+		enum State : uint8_t
+		{
+			Idle,
+			Queued,
+			Running,
+			Complete
+		};
+
+		std::thread _task[MaxCryptoWorkers];
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		bool _running = false;
+		Server::Wake _wake;
+		Work _work[MaxHttpSessions];
+		State _state[MaxHttpSessions] = {};
+		sid_t _queue[MaxHttpSessions];		// queued sessions, each session has at most one work
+		unsigned _head = 0;
+		unsigned _tail = 0;
+		Srp::Ctx _ctx[MaxCryptoWorkers];	// calculation contexts of worker tasks
+
+		void run(unsigned n)
+		{
+			Log::Msg("CryptoPool::Run %d - enter\n", n);
+
+			while (true)
+			{
+				sid_t sid;
+				Work work;
+				{
+					std::unique_lock<std::mutex> lock(_mtx);
+					_cv.wait(lock, [this] { return !_running || _head != _tail; });
+					if (_head == _tail)		// not running and no more work
+						break;
+					sid = _queue[_head++ % sizeofarr(_queue)];
+					work = std::move(_work[sid]);
+					_state[sid] = Running;
+				}
+
+				work(_ctx[n]);
+
+				{
+					std::unique_lock<std::mutex> lock(_mtx);
+					_state[sid] = Complete;
+				}
+				_cv.notify_all();
+
+				if (_wake)
+					_wake();
+			}
+
+			Log::Msg("CryptoPool::Run %d - exit\n", n);
+		}
+	} cryptoPool;
+
+	// Pair Resume cache
+	//	keeps shared secrets of verified sessions so a reconnecting controller
+	//	resumes without Curve25519 and Ed25519 of the full Pair Verify,
+	//	one session per controller, the oldest session is replaced when the cache is full,
+	//	accessed from the network task only
+	class ResumeCache
+	{
+	public:
+		static constexpr unsigned IdLen = 8;		// resume session ID size
+		static constexpr unsigned SecretLen = 32;	// shared secret size
+
+		struct Entry
+		{
+			bool used = false;
+			uint8_t id[IdLen];					// resume session ID
+			uint8_t secret[SecretLen];			// shared secret of the session
+			uint8_t iosLen;
+			Controller::Id ios;					// controller pairing ID
+			Timer::Point expire;
+		};
+
+		// statistics
+		uint32_t hit = 0;		// sessions resumed
+		uint32_t miss = 0;		// unknown session ID or authentication failure
+		uint32_t expired = 0;	// session ID found but expired
+		uint32_t evicted = 0;	// sessions replaced to make room
+
+		// store session, replaces previous session of the same controller
+		void Add(const Controller* ios, const uint8_t* id, const uint8_t* secret)
+		{
+			Entry* e = nullptr;
+
+			for (unsigned i = 0; i < sizeofarr(_e); i++)
+			{
+				Entry* t = &_e[i];
+
+				if (t->used && t->iosLen == ios->idLen && memcmp(t->ios, ios->id, ios->idLen) == 0)
+				{
+					e = t;
+					break;
+				}
+
+				if (e == nullptr || (e->used && (!t->used || t->expire < e->expire)))
+					e = t;
+			}
+
+			if (e->used && (e->iosLen != ios->idLen || memcmp(e->ios, ios->id, ios->idLen) != 0))
+				evicted++;
+
+			e->used = true;
+			memcpy(e->id, id, IdLen);
+			memcpy(e->secret, secret, SecretLen);
+			e->iosLen = ios->idLen;
+			memcpy(e->ios, ios->id, ios->idLen);
+			e->expire = Timer::now() + std::chrono::seconds(ResumeTimeout);
+		}
+
+		// find session by ID, expired session is removed
+		//	the session stays in the cache until the request is authenticated,
+		//	then Add replaces it with the new session ID, so a session ID is used once
+		//	returns false if the session is unknown or expired
+		bool Find(const uint8_t* id, Entry& e)
+		{
+			for (unsigned i = 0; i < sizeofarr(_e); i++)
+			{
+				Entry* t = &_e[i];
+
+				if (!t->used || memcmp(t->id, id, IdLen) != 0)
+					continue;
+
+				if (Timer::now() >= t->expire)
+				{
+					expired++;
+					_clear(t);
+					return false;
+				}
+
+				e = *t;
+				return true;
+			}
+
+			miss++;
+			return false;
+		}
+
+		// remove session of controller (pairing removed)
+		void Remove(const uint8_t* ios, uint32_t iosLen)
+		{
+			for (unsigned i = 0; i < sizeofarr(_e); i++)
+			{
+				Entry* t = &_e[i];
+
+				if (t->used && t->iosLen == iosLen && memcmp(t->ios, ios, iosLen) == 0)
+					_clear(t);
+			}
+		}
+
+		void log()
+		{
+			uint32_t total = hit + miss + expired;
+
+			Log::Msg("PairResume: hit %u  miss %u  expired %u  evicted %u  hit rate %u%%\n",
+				hit, miss, expired, evicted, total ? hit * 100 / total : 0);
+		}
+
+	private:
+		Entry _e[MaxResumeSessions];
+
+		void _clear(Entry* t)
+		{
+			t->used = false;
+			memset(t->secret, 0, sizeof(t->secret));
+		}
+	} resumeCache;
+
+	// close current pairing and prepare (b, B) for the next one
+	static void srpClose(sid_t sid)
+	{
+		if (!srp.active(sid))
+			return;
+
+		srp.close(sid);
+		srpPrecalc.Request(Hap::config->srpSalt, Hap::config->srpVerifier);
+	}
+
+	// restore verifier and its v^u comb table from config data
+	//	done by Start, so M1 repeats it only when the salt has changed since
+	static bool srpRestore()
+	{
+		if (!Hap::config->srpValid)
+			return false;
+
+		if (memcmp(ver.s, Hap::config->srpSalt, Srp::SRP_SALT_BYTES) == 0)
+			return true;
+
+		if (ver.init(srpCtx, Username, Hap::config->setupCode, Hap::config->srpSalt, Hap::config->srpVerifier))
+			return true;
+
+		memset(ver.s, 0, sizeof(ver.s));	// restore again on next call
+		return false;
+	}
+
+	// bind the fastest char search kernel of the request parser
+	//	each supported kernel must parse a sample request as the portable one does,
+	//	and is timed on the same request
+	static void parserSelect()
+	{
+		static const char req[] =
+			"PUT /characteristics HTTP/1.1\r\n"
+			"Host: Accessory._hap._tcp.local:51827\r\n"
+			"User-Agent: HomeKit/1.0 CFNetwork/1240.0.4 Darwin/20.5.0\r\n"
+			"Accept: */*\r\n"
+			"Accept-Encoding: gzip, deflate, br\r\n"
+			"Content-Type: application/hap+json\r\n"
+			"Content-Length: 38\r\n"
+			"Connection: keep-alive\r\n"
+			"\r\n"
+			"{\"characteristics\":[{\"aid\":1,\"iid\":9}]}";
+		constexpr unsigned Parses = 1000;
+		constexpr unsigned Rounds = 3;
+
+		struct Result
+		{
+			int rc;
+			const char* method;
+			const char* path;
+			uint32_t method_len;
+			uint32_t path_len;
+			int minor_version;
+			phr_header hdr[MaxHttpHeaders];
+			uint32_t num;
+
+			void parse()
+			{
+				num = sizeofarr(hdr);
+				rc = phr_parse_request(req, sizeof(req) - 1, &method, &method_len, &path, &path_len, &minor_version, hdr, &num, 0);
+			}
+
+			bool operator==(const Result& r) const
+			{
+				if (rc != r.rc || method != r.method || method_len != r.method_len || path != r.path || path_len != r.path_len || num != r.num)
+					return false;
+				for (uint32_t i = 0; i < num; i++)
+				{
+					if (hdr[i].name != r.hdr[i].name || hdr[i].name_len != r.hdr[i].name_len
+						|| hdr[i].value != r.hdr[i].value || hdr[i].value_len != r.hdr[i].value_len)
+						return false;
+				}
+				return true;
+			}
+		} ref, res;
+
+		phr_select("ref");
+		ref.parse();
+
+		const char* best = "ref";
+		Timer::DurUs bestUs = 0;
+
+		for (unsigned i = 0; phr_kernel(i) != nullptr; i++)
+		{
+			const char* k = phr_select(phr_kernel(i));
+
+			res.parse();
+			if (!(res == ref))
+			{
+				Log::Err("Http: parser kernel %s failed self-test\n", k);
+				continue;
+			}
+
+			Timer::DurUs us = 0;
+			for (unsigned r = 0; r < Rounds; r++)
+			{
+				Timer::Point t = Timer::now();
+				for (unsigned n = 0; n < Parses; n++)
+					res.parse();
+				Timer::DurUs d = Timer::us(t, Timer::now());
+				if (r == 0 || d < us)
+					us = d;
+			}
+
+			Log::Dbg("Http: parser kernel %s %llu ns\n", k, (unsigned long long)us * 1000 / Parses);
+			if (bestUs == 0 || us < bestUs)
+			{
+				best = k;
+				bestUs = us;
+			}
+		}
+
+		phr_select(best);
+		Log::Msg("Http: parser kernel %s (%llu ns)\n", best, (unsigned long long)bestUs * 1000 / Parses);
+	}
+
+	void Server::Start(Wake wake)
+	{
+		parserSelect();
+
+		// static memory budget of HTTP processing
+		uint32_t sess = sizeof(Session) * sizeofarr(_sess);
+		uint32_t scratch = sizeof(Scratch) * sizeofarr(_scratch);
+		Log::Msg("Http: session %u x %u  scratch %u x %u  buffers %u  total %u bytes\n",
+			(unsigned)sizeof(Session), (unsigned)sizeofarr(_sess), (unsigned)sizeof(Scratch), (unsigned)sizeofarr(_scratch),
+			_pool.footprint(), sess + scratch + _pool.footprint());
+
+		// verifier comb is built here, not on the first Pair Setup M1
+		if (!srpRestore())
+			Log::Err("Http: SRP verifier is not valid\n");
+
+		srpPrecalc.Start();
+		srpPrecalc.Request(Hap::config->srpSalt, Hap::config->srpVerifier);
+		if (wake)
+			cryptoPool.Start(wake);
+	}
+
+	void Server::Stop()
+	{
+		cryptoPool.Stop();
+		srpPrecalc.Stop();
+	}
 
 	// Open
 	//	returns new session ID, 0..sid_max, or sid_invalid
@@ -26,8 +524,8 @@ namespace Hap::Http
 			if (_sess[sid].isOpen())
 				continue;
 
-			// open session - use same buffers for all sessions
-			_sess[sid].Open(sid, &_buf);
+			// open session, its buffers are taken from the pool per request
+			_sess[sid].Open(sid);
 
 			// open database
 			_db.Open(sid);
@@ -48,13 +546,19 @@ namespace Hap::Http
 		if (!_sess[sid].isOpen())
 			return false;
 
+		// wait for crypto worker before releasing the session data
+		if (_sess[sid].done != nullptr)
+			cryptoPool.Wait(sid);
+
 		_db.Close(sid);
 
 		_sess[sid].Close();
+		_release(&_sess[sid]);
 
 		// cancel current pairing if any
-		if (srp.active(sid))
-			srp.close(sid);
+		srpClose(sid);
+
+		_pool.log();
 
 		return true;
 	}
@@ -65,7 +569,6 @@ namespace Hap::Http
 			return false;
 
 		Session* sess = &_sess[sid];
-		bool secured = sess->secured;
 
 		Log::Msg("Http::Process Ses %d  secured %d  %s\n", sid, sess->secured, sess->ios ? (sess->ios->perm == Hap::Controller::Perm::Admin ? "admin" : "user") : "?");
 
@@ -76,616 +579,1035 @@ namespace Hap::Http
 			return false;
 		}
 
-		// prepare for request parsing
-		sess->Init();
+		if (!_acquire(sess, ReqSize))
+			return false;
 
-		// read and parse the HTTP request
-		uint16_t len = 0;		// total len of valid data received so far
-		uint16_t http_len = 0;	// current length of http request
-		while (true)
+		bool rc = _process(sess, recv, send);
+
+		_release(sess);
+
+		return rc;
+	}
+
+	// take scratch and buffers of one request from the pool
+	//	req - min size of request buffer, 0 if the request buffer is not needed,
+	//	the request buffer that keeps data received after previous request is reused
+	bool Server::_acquire(Session* sess, uint16_t req)
+	{
+		Buf& b = sess->buf;
+
+		for (auto& x : _scratch)
 		{
-			uint8_t* req = sess->data() + len;
-			uint16_t req_len = sess->sizeofdata() - len;
-				
-			// read next portion of the request
-			int l = recv(sid, (char*)req, req_len);
-			if (l < 0)	// read error
-			{
-				Log::Err("Http: Read Error %d\n", l);
-				return false;
-			}
-			if (l == 0)
-			{
-				Log::Msg("Http: Read EOF\n");
-				return false;
-			}
+			if (x.used)
+				continue;
 
-			len += l;
+			x.used = true;
+			sess->scratch = &x;
+			sess->req = &x.req;
+			sess->wrParser = &x.wrParser;
+			sess->wr = &x.wr;
+			break;
+		}
 
-			if (sess->secured)
-			{
-				// it session is secured, decrypt the block - when the whole block is received
-				//	max length of http data that can be processed is defined by MaxHttpFrame/MaxHttpBlock
+		if (sess->scratch != nullptr
+			&& (req == 0 || b.req.p() != nullptr || _pool.Get(req, b.req))
+			&& _pool.Get(RspSize, b.rsp)
+			&& _pool.Get(TmpSize, b.tmp))
+			return true;
 
-				if (len < 2)	// wait fot at least two bytes of data length 
-					continue;
-					
-				uint8_t *p = sess->data();
-				uint16_t aad = p[0] + ((uint16_t)(p[1]) << 8);	// data length, also serves as AAD for decryption
+		Log::Err("Http: no free buffers for Ses %d\n", sess->Sid());
+		_release(sess);
+		return false;
+	}
 
-				if (aad > MaxHttpBlock)
-				{
-					Log::Err("Http: encrypted block size is too big: %d\n", aad);
-					return false;
-				}
+	// return scratch and buffers to the pool
+	//	the request buffer is kept while it holds data received after the request
+	void Server::_release(Session* sess)
+	{
+		Buf& b = sess->buf;
 
-				if (len < 2 + aad + 16)	// wait for complete encrypted block
-					continue;
+		if (b.rsp.p() != nullptr)
+			_pool.Put(b.rsp);
+		if (b.tmp.p() != nullptr)
+			_pool.Put(b.tmp);
 
-				// ensure the new portion of data fits into the request buffer
-				if (http_len + aad > sess->req.size() - 16)	// leave room for 16-bit tag
+		if (b.req.p() != nullptr)
+		{
+			if (sess->holdLen == 0)
+				_pool.Put(b.req);
+			else if (b.req.l() > ReqSize && sess->holdLen <= ReqSize)
+			{
+				// data kept in a bigger buffer moves to a request buffer,
+				//	so the bigger buffer is available for large requests of other sessions
+				Hap::Buf<char> r;
+				if (_pool.Get(ReqSize, r))
 				{
-					Log::Err("Http: encrypted request is too big: %d + %d = %d\n", http_len, aad, http_len + aad);
-					return false;
+					if (r.l() < b.req.l())
+					{
+						memcpy(r.p(), b.req.p(), sess->holdLen);
+						_pool.Put(b.req);
+						b.req = r;
+					}
+					else
+						_pool.Put(r);
 				}
+			}
+		}
 
-				// make 96-bit nonce from receive sequential number
-				uint8_t nonce[12];
-				memset(nonce, 0, sizeof(nonce));
-				memcpy(nonce + 4, &sess->recvSeq, 8);
+		if (sess->scratch != nullptr)
+		{
+			sess->scratch->used = false;
+			sess->scratch = nullptr;
+			sess->req = nullptr;
+			sess->wrParser = nullptr;
+			sess->wr = nullptr;
+		}
+	}
 
-				// decrypt into request buffer
-				uint8_t* b = (uint8_t*)sess->req.buf() + http_len;
+	// move request into bigger buffer when it does not fit the current one
+	//	len - length of data in the buffer
+	bool Server::_grow(Session* sess, uint16_t len)
+	{
+		Hap::Buf<char> b;
+		if (!_pool.Get(sess->req->size() + 1, b))
+			return false;
 
-				Crypto::Aead aead(Crypto::Aead::Decrypt,
-					b, b + aad,							// output data and tag positions
-					sess->ControllerToAccessoryKey,		// decryption key
-					nonce,
-					p + 2, aad,							// encrypted data
-					p, 2								// aad
-				);
+		memcpy(b.p(), sess->req->buf(), len);
+		sess->req->move(b.p(), (uint16_t)b.l());
 
-				sess->recvSeq++;
+		_pool.Put(sess->buf.req);
+		sess->buf.req = b;
 
-				// compare passed in and calculated tags
-				if (memcmp(b + aad, p + 2 + aad, 16) != 0)
-				{
-					Log::Err("Http: decrypt error\n");
-					return false;
-				}
+		Log::Dbg("Http: request buffer of Ses %d grows to %d\n", sess->Sid(), b.l());
+		return true;
+	}
 
-				http_len += aad;
+	bool Server::_process(Session* sess, Recv& recv, Send& send)
+	{
+		sid_t sid = sess->Sid();
 
-				// if there is more data after encypted block
-				// move it to block start 
-				if (len > 2 + aad + 16)
-				{
-					len -= 2 + aad + 16;
-					b = (uint8_t*)sess->req.buf();
-					memmove(b, b + 2 + aad + 16, len);
-				}
-			}
-			else  // unsequred session
-			{
-				// ensure the new portion of data fits into the request buffer
-				if (http_len + len > sess->req.size())
-				{
-					Log::Err("Http: request is too big: %d + %d = %d\n", http_len, len, http_len + len);
-					return false;
-				}
+		// prepare for request parsing
+		sess->Init();
 
-				// copy received data into request buffer as is
-				memcpy(sess->req.buf() + http_len, sess->data(), len);
+		// data received after previous request is kept at the request buffer start
+		uint8_t* buf = (uint8_t*)sess->req->buf();
+		Rx rx;
+		rx.len = sess->holdLen;
+		rx.pos = rx.plain = sess->holdPlain;
+		sess->holdLen = sess->holdPlain = 0;
 
-				http_len += len;
-				len = 0;
-			}
+		// process all complete requests, only the first one waits for data,
+		//	the rest come from data already received (pipelined requests)
+		bool wait = true;
+		while (true)
+		{
+			bool secured = sess->secured;
 
-			// try parsing HTTP request
-			auto status = sess->req.parse(http_len);
-			if (status == sess->req.Error)	// parser error
-			{
-				// send response 'Internal server error'
-				sess->rsp.start(Status::HTTP_500);
-				sess->rsp.end();
-				send(sid, sess->rsp.buf(), sess->rsp.len());
+			int rc = _recv(sess, recv, send, rx, wait);
+			if (rc < 0)
 				return false;
-			}
 
-			if (status == sess->req.Success)
-				// request parsed, stop reading 
+			// the request may have been moved into bigger buffer
+			buf = (uint8_t*)sess->req->buf();
+
+			if (rc == 0)
 				break;
 
-			// status = Incomplete -> read more data
-		}
+			_dispatch(sess, secured);
 
-		auto m = sess->req.method();
-		Log::Msg("Method: '%.*s'\n", m.l(), m.p());
+			// move data that follows the request to buffer start
+			uint16_t n = (uint16_t)sess->req->length();
+			memmove(buf, buf + n, rx.plain - n);
+			memmove(buf + rx.plain - n, buf + rx.pos, rx.len - rx.pos);
+			rx.len = rx.plain - n + rx.len - rx.pos;
+			rx.pos = rx.plain = rx.plain - n;
 
-		auto p = sess->req.path();
-		Log::Msg("Path: '%.*s'\n", p.l(), p.p());
+			// parked on crypto worker, the response is sent by Resume
+			if (sess->done != nullptr)
+			{
+				Log::Msg("Http::Process parked Ses %d\n", sid);
+				break;
+			}
 
-		auto d = sess->req.data();
+			if (!_send(sess, send))
+				return false;
 
-		for (uint32_t i = 0; i < sess->req.hdr_count(); i++)
-		{
-			auto n = sess->req.hdr_name(i);
-			auto v = sess->req.hdr_value(i);
-			Log::Msg("%.*s: '%.*s'\n", n.l(), n.p(), v.l(), v.p());
+			// data following the request that secured the session is encrypted
+			if (secured && !sess->secured)
+				rx.pos = rx.plain = 0;
+
+			sess->secured = secured;
+			Log::Msg("Http::Process exit Ses %d  secured %d\n", sid, sess->secured);
+
+			sess->Init();
+			wait = false;
 		}
 
-		if (m.l() == 4 && strncmp(m.p(), "POST", 4) == 0)
-		{
-			// POST
-			//		/identify
-			//		/pair-setup
-			//		/pair-verify
-			//		/pairings
+		// keep incomplete request in the request buffer until next call
+		sess->holdLen = rx.len;
+		sess->holdPlain = rx.plain;
 
-			if (p.l() == 9 && strncmp(p.p(), "/identify", 9) == 0)
-			{
-				if (_pairings.Count() == 0)
-				{
-					Log::Msg("Http: Exec unpaired identify\n");
-					sess->rsp.start(Status::HTTP_204);
-					sess->rsp.end();
-				}
-				else
-				{
-					Log::Msg("Http: Unpaired identify prohibited when paired\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.add(ContentType, ContentTypeJson);
-					sess->rsp.end("{\"status\":-70401}");
-				}
-			}
-			else if (p.l() == 11 && strncmp(p.p(), "/pair-setup", 11) == 0)
+		return true;
+	}
+
+	// receive and decrypt request data until complete request is parsed
+	//	returns 1 - request parsed, 0 - request incomplete and wait is false,
+	//	-1 - error, the connection must be closed
+	int Server::_recv(Session* sess, Recv& recv, Send& send, Rx& rx, bool wait)
+	{
+		uint8_t* buf = (uint8_t*)sess->req->buf();
+		uint16_t parsed = 0;	// length of data parsed so far
+
+		while (true)
+		{
+			if (sess->secured)
 			{
-				int len;
-				if (!sess->req.hdr(ContentType, ContentTypeTlv8))
-				{
-					Log::Msg("Http: Unknown or missing ContentType\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentLength, len))
-				{
-					Log::Err("Http: Unknown or missing ContentLength\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else
+				// it session is secured, decrypt all complete blocks in place,
+				//	plaintext follows previously decrypted data
+				//	max length of http data that can be processed is defined by MaxHttpFrame/MaxHttpBlock
+				while (rx.len - rx.pos >= 2)	// wait fot at least two bytes of data length
 				{
-					sess->tlvi.parse(d.p(), d.l());
-					Log::Msg("PairSetup: TLV item count %d\n", sess->tlvi.count());
+					uint8_t *p = buf + rx.pos;
+					uint16_t aad = p[0] + ((uint16_t)(p[1]) << 8);	// data length, also serves as AAD for decryption
 
-					Tlv::State state;
-					if (!sess->tlvi.get(Tlv::Type::State, state))
+					if (aad > MaxHttpBlock)
 					{
-						Log::Msg("PairSetup: State not found\n");
+						Log::Err("Http: encrypted block size is too big: %d\n", aad);
+						return -1;
 					}
-					else
+
+					if (rx.len - rx.pos < 2 + aad + 16)	// wait for complete encrypted block
+						break;
+
+					// make 96-bit nonce from receive sequential number
+					uint8_t nonce[12];
+					memset(nonce, 0, sizeof(nonce));
+					memcpy(nonce + 4, &sess->recvSeq, 8);
+
+					uint8_t tag[16];
+					Crypto::Aead aead(Crypto::Aead::Decrypt,
+						buf + rx.plain, tag,				// output data and tag positions
+						sess->ControllerToAccessoryKey,		// decryption key
+						nonce,
+						p + 2, aad,							// encrypted data
+						p, 2								// aad
+					);
+
+					sess->recvSeq++;
+
+					// compare passed in and calculated tags
+					if (memcmp(tag, p + 2 + aad, 16) != 0)
 					{
-						switch (state)
-						{
-						case Tlv::State::M1:
-							_pairSetup1(sess);
-							break;
-
-						case Tlv::State::M3:
-							_pairSetup3(sess);
-							break;
-
-						case Tlv::State::M5:
-							_pairSetup5(sess);
-							break;
-
-						default:
-							Log::Err("PairSetup: Unknown state %d\n", (int)state);
-						}
+						Log::Err("Http: decrypt error\n");
+						return -1;
 					}
+
+					rx.plain += aad;
+					rx.pos += 2 + aad + 16;
 				}
 			}
-			else if (p.l() == 12 && strncmp(p.p(), "/pair-verify", 12) == 0)
+			else  // unsequred session
 			{
-				int len;
-				if (!sess->req.hdr(ContentType, ContentTypeTlv8))
+				// received data is the request as is
+				rx.plain = rx.pos = rx.len;
+			}
+
+			// try parsing HTTP request when new data is available
+			if (rx.plain > parsed && !rx.stream)
+			{
+				parsed = rx.plain;
+
+				auto status = sess->req->parse(rx.plain);
+				if (status == sess->req->Error)	// parser error
 				{
-					Log::Err("Http: Unknown or missing ContentType\n");
-					sess->rsp.start(Status::HTTP_400);
+					// send response 'Internal server error'
+					sess->rsp.start(Status::HTTP_500);
 					sess->rsp.end();
+					send(sess->Sid(), sess->rsp.buf(), sess->rsp.len());
+					return -1;
 				}
-				else if (!sess->req.hdr(ContentLength, len))
+
+				// data of some requests (PUT /characteristics) is processed while it arrives,
+				//	the streaming starts only when it can be finished by this call
+				//	because the response buffer is shared by sessions
+				const Route* r = nullptr;
+				if (status != sess->req->Incomplete && (wait || status == sess->req->Success))
+					r = _route(sess);
+
+				if (r != nullptr && r->start != nullptr &&
+					_check(sess, *r) == Status::HTTP_200 && (this->*r->start)(sess))
 				{
-					Log::Err("Http: Unknown or missing ContentLength\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
+					rx.stream = true;
+					rx.hdr = (uint16_t)sess->req->hdrLength();
+					rx.left = sess->req->data().l();
+					parsed = rx.hdr;
 				}
-				else
-				{
-					sess->tlvi.parse(d.p(), d.l());
-					Log::Msg("PairVerify: TLV item count %d\n", sess->tlvi.count());
+				else if (status == sess->req->Success)
+					// request parsed, stop reading
+					return 1;
 
-					Tlv::State state;
-					if (!sess->tlvi.get(Tlv::Type::State, state))
-					{
-						Log::Err("PairVerify: State not found\n");
-					}
-					else
-					{
-						switch (state)
-						{
-						case Tlv::State::M1:
-							_pairVerify1(sess);
-							break;
-
-						case Tlv::State::M3:
-							_pairVerify3(sess);
-							secured = sess->ios != nullptr;
-							break;
-						default:
-							Log::Err("PairVerify: Unknown state %d\n", (int)state);
-						}
-					}
-				}
+				// status = Incomplete/Headers -> read more data
 			}
-			else if (p.l() == 9 && strncmp(p.p(), "/pairings", 9) == 0)
+
+			// process streamed data, drop it from the buffer when done
+			if (rx.stream && (rx.plain > parsed || rx.left == 0))
 			{
-				int len;
-				if (!sess->secured)
+				uint16_t l = rx.plain - rx.hdr;
+				bool last = l >= rx.left;
+				if (last)
+					l = (uint16_t)rx.left;
+
+				uint16_t n = _writeData(sess, (const char*)buf + rx.hdr, l, last);
+
+				memmove(buf + rx.hdr, buf + rx.hdr + n, rx.len - rx.hdr - n);
+				rx.len -= n;
+				rx.pos -= n;
+				rx.plain -= n;
+				rx.left -= n;
+				sess->req->consume(n);
+				parsed = rx.plain;
+
+				if (rx.left == 0)
 				{
-					Log::Err("Http: Authorization required\n");
-					sess->rsp.start(Status::HTTP_470);
-					sess->rsp.end();
+					rx.stream = false;
+					return 1;
 				}
-				else if (!sess->req.hdr(ContentType, ContentTypeTlv8))
-				{
-					Log::Err("Http: Unknown or missing ContentType\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentLength, len))
+			}
+
+			if (!wait)
+				return 0;
+
+			// ensure there is room for the next portion of the request
+			if (rx.len >= sess->req->size())
+			{
+				if (!_grow(sess, rx.len))
 				{
-					Log::Err("Http: Unknown or missing ContentLength\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
+					Log::Err("Http: request is too big: %d\n", rx.len);
+					return -1;
 				}
-				else
-				{
-					sess->tlvi.parse(d.p(), d.l());
-					Log::Msg("Pairings: TLV item count %d\n", sess->tlvi.count());
+				buf = (uint8_t*)sess->req->buf();
+			}
 
-					Tlv::State state;
-					if (!sess->tlvi.get(Tlv::Type::State, state))
-					{
-						Log::Err("Pairings: State not found\n");
-						sess->rsp.start(Status::HTTP_400);
-						sess->rsp.end();
-					}
-					else
-					{
-						if(state != Tlv::State::M1)
-						{
-							Log::Err("Pairings: Invalid State\n");
-							sess->rsp.start(Status::HTTP_400);
-							sess->rsp.end();
-						}
-						else
-						{
-							Tlv::Method method;
-							if (!sess->tlvi.get(Tlv::Type::Method, method))
-							{
-								Log::Err("Pairings: Method not found\n");
-								sess->rsp.start(Status::HTTP_400);
-								sess->rsp.end();
-							}
-							else
-							{
-								switch (method)
-								{
-								case Tlv::Method::AddPairing:
-									_pairingAdd(sess);
-									break;
-
-								case Tlv::Method::RemovePairing:
-									_pairingRemove(sess);
-									break;
-
-								case Tlv::Method::ListPairing:
-									_pairingList(sess);
-									break;
-								default:
-									Log::Err("Pairings: Unknown method\n");
-									sess->rsp.start(Status::HTTP_400);
-									sess->rsp.end();
-								}
-							}
-						}
-					}
-				}
+			// read next portion of the request
+			int l = recv(sess->Sid(), (char*)buf + rx.len, sess->req->size() - rx.len);
+			if (l < 0)	// read error
+			{
+				Log::Err("Http: Read Error %d\n", l);
+				return -1;
 			}
-			else
+			if (l == 0)
 			{
-				Log::Err("Http: Unknown path %.*s\n", p.l(), p.p());
-				sess->rsp.start(Status::HTTP_400);
-				sess->rsp.end();
+				Log::Msg("Http: Read EOF\n");
+				return -1;
 			}
+
+			rx.len += l;
 		}
-		else if (m.l() == 3 && strncmp(m.p(), "GET", 3) == 0)
+	}
+
+	// request routes
+	//	the slot table is built at compile time, each route is found by hash of its method and path
+	constexpr Server::Route Server::_routes[RouteCount] =
+	{
+		{ "POST", "/identify", 0, &Server::_postIdentify },
+		{ "POST", "/pair-setup", RouteTlv8, &Server::_postPairSetup },
+		{ "POST", "/pair-verify", RouteTlv8, &Server::_postPairVerify },
+		{ "POST", "/pairings", RouteSecured | RouteTlv8, &Server::_postPairings },
+		{ "GET", "/accessories", RouteSecured, &Server::_getAccessories },
+		{ "GET", "/characteristics", RouteSecured, &Server::_getCharacteristics },
+		{ "PUT", "/characteristics", RouteSecured | RouteJson, &Server::_putCharacteristics, &Server::_writeStart },
+		{ "PUT", "/prepare", RouteSecured | RouteJson, &Server::_putPrepare },
+	};
+
+	constexpr std::array<uint8_t, Server::RouteSlots> Server::_routeTable()
+	{
+		std::array<uint8_t, RouteSlots> slots{};
+
+		for (uint8_t i = 0; i < RouteCount; i++)
 		{
-			// GET
-			//		/accessories
-			//		/characteristics
-			if (!sess->secured)
-			{
-				Log::Err("Http: Authorization required\n");
-				sess->rsp.start(Status::HTTP_470);
-				sess->rsp.end();
-			}
-			else if (p.l() == 12 && strncmp(p.p(), "/accessories", 12) == 0)
-			{
-				sess->rsp.start(Status::HTTP_200);
-				sess->rsp.add(ContentType, ContentTypeJson);
-				sess->rsp.add(ContentLength, 0);
-				sess->rsp.end();
+			const Route& r = _routes[i];
+			uint32_t h = _routeHash(r.method, r.mlen, r.path, r.plen);
 
-				int len = _db.getDb(sess->Sid(), sess->rsp.data(), sess->rsp.size());
+			// linear probing, the table is never full
+			while (slots[h % RouteSlots] != 0)
+				h++;
+			slots[h % RouteSlots] = i + 1;
+		}
 
-				Log::Dbg("Db: '%.*s'\n", len, sess->rsp.data());
+		return slots;
+	}
 
-				sess->rsp.setContentLength(len);
-			}
-			else if(strncmp(p.p(), "/characteristics?", 17) == 0)
-			{
+	constexpr std::array<uint8_t, Server::RouteSlots> Server::_routeSlots = Server::_routeTable();
 
-				int len = sess->sizeofdata();
-				auto status = _db.Read(sess->Sid(), p.p() + 17, p.l() - 17, (char*)sess->data(), len);
+	// find route of parsed request, the query string is not part of the route path
+	//	returns nullptr for unknown request
+	const Server::Route* Server::_route(Session* sess)
+	{
+		auto m = sess->req->method();
+		auto p = sess->req->path();
 
-				Log::Msg("Read: Status %d  '%.*s'\n", status, len, sess->data());
+		uint16_t pl = p.l();
+		const char* q = (const char*)memchr(p.p(), '?', pl);
+		if (q != nullptr)
+			pl = uint16_t(q - p.p());
 
-				sess->rsp.start(status);
-				if (len > 0)
-				{
-					sess->rsp.add(ContentType, ContentTypeJson);
-					sess->rsp.end((const char*)sess->data(), len);
-				}
-				else
-				{
-					sess->rsp.end();
-				}
-			}
-			else
-			{
-				Log::Err("Http: Unknown path %.*s\n", p.l(), p.p());
-				sess->rsp.start(Status::HTTP_400);
-				sess->rsp.end();
-			}
+		uint32_t h = _routeHash(m.p(), m.l(), p.p(), pl);
+		for (uint8_t n = 0; n < RouteSlots; n++, h++)
+		{
+			uint8_t i = _routeSlots[h % RouteSlots];
+			if (i == 0)
+				break;
+
+			const Route& r = _routes[i - 1];
+			if (r.mlen == m.l() && r.plen == pl
+				&& memcmp(r.method, m.p(), r.mlen) == 0
+				&& memcmp(r.path, p.p(), pl) == 0)
+				return &r;
 		}
-		else if (m.l() == 3 && strncmp(m.p(), "PUT", 3) == 0)
+
+		return nullptr;
+	}
+
+	// check the request against requirements of its route
+	//	returns HTTP_200 when the request is accepted, otherwise error status of the response
+	Status Server::_check(Session* sess, const Route& r)
+	{
+		int len;
+
+		if ((r.check & RouteSecured) && !sess->secured)
 		{
-			// PUT
-			//		/characteristics
-			//		/prepare
-			if (p.l() == 16 && strncmp(p.p(), "/characteristics", 16) == 0)
-			{
-				int len;
-				if (!sess->secured)
-				{
-					Log::Err("Http: Authorization required\n");
-					sess->rsp.start(Status::HTTP_470);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentType, ContentTypeJson))
-				{
-					Log::Err("Http: Unknown or missing ContentType\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentLength, len))
-				{
-					Log::Err("Http: Unknown or missing ContentLength\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else
-				{
-					Log::Msg("Http: %.*s\n", d.l(), d.p());
+			Log::Err("Http: Authorization required\n");
+			return Status::HTTP_470;
+		}
 
-					Hap::Json::Parser& wr{ sess->wrParser };
-					wr.init();
-					int rc = wr.parse((const char*)d.p(), d.l());
-					Log::Msg("parse = %d\n", rc);
+		if (((r.check & RouteTlv8) && !sess->req->hdr(ContentType, ContentTypeTlv8))
+			|| ((r.check & RouteJson) && !sess->req->hdr(ContentType, ContentTypeJson)))
+		{
+			Log::Err("Http: Unknown or missing ContentType\n");
+			return Status::HTTP_400;
+		}
 
-					Hap::Http::Status status;
-					int len = 0;
+		if ((r.check & (RouteTlv8 | RouteJson)) && !sess->req->hdr(ContentLength, len))
+		{
+			Log::Err("Http: Unknown or missing ContentLength\n");
+			return Status::HTTP_400;
+		}
 
-					// expect root object
-					if (!rc || wr.tk(0)->type != Hap::Json::JSMN_OBJECT)
-					{
-						Log::Err("JSON parse error rc %d\n", rc);
-						status = Http::Status::HTTP_400;	// Bad request
-					}
-					else
-					{
-						wr.dump();
+		return Status::HTTP_200;
+	}
 
-						len = sess->sizeofdata();
-						status = _db.Write(sess->Sid(), wr, (char*)sess->data(), len);
-					}
+	// process parsed request and create the response
+	//	secured is set when the session becomes secured after the response is sent
+	void Server::_dispatch(Session* sess, bool& secured)
+	{
+		auto m = sess->req->method();
+		Log::Msg("Method: '%.*s'\n", m.l(), m.p());
 
-					Log::Msg("Write: Status %d  '%.*s'\n", status, len, sess->data());
+		auto p = sess->req->path();
+		Log::Msg("Path: '%.*s'\n", p.l(), p.p());
 
-					sess->rsp.start(status);
-					if (len > 0)
-					{
-						sess->rsp.add(ContentType, ContentTypeJson);
-						sess->rsp.end((const char*)sess->data(), len);
-					}
-					else
-					{
-						sess->rsp.end();
-					}
-				}
-			}
+		for (uint32_t i = 0; i < sess->req->hdr_count(); i++)
+		{
+			auto n = sess->req->hdr_name(i);
+			auto v = sess->req->hdr_value(i);
+			Log::Msg("%.*s: '%.*s'\n", n.l(), n.p(), v.l(), v.p());
+		}
 
-			else if (p.l() == 8 && strncmp(p.p(), "/prepare", 8) == 0)
-			{
-				int len;
-				if (!sess->secured)
-				{
-					Log::Err("Http: Authorization required\n");
-					sess->rsp.start(Status::HTTP_470);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentType, ContentTypeJson))
-				{
-					Log::Err("Http: Unknown or missing ContentType\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else if (!sess->req.hdr(ContentLength, len))
-				{
-					Log::Err("Http: Unknown or missing ContentLength\n");
-					sess->rsp.start(Status::HTTP_400);
-					sess->rsp.end();
-				}
-				else
-				{
-					Log::Msg("Http: %.*s\n", d.l(), d.p());
+		const Route* r = _route(sess);
+		if (r == nullptr)
+		{
+			Log::Err("Http: Unknown path %.*s %.*s\n", m.l(), m.p(), p.l(), p.p());
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.end();
+			return;
+		}
 
-					Hap::Json::Parser& wr{ sess->wrParser };
-					wr.init();
-					int rc = wr.parse((const char*)d.p(), d.l());
-					Log::Msg("parse = %d\n", rc);
+		Status status = _check(sess, *r);
+		if (status != Status::HTTP_200)
+		{
+			sess->rsp.start(status);
+			sess->rsp.end();
+			return;
+		}
 
-					Hap::Http::Status status;
-					int len = 0;
+		(this->*r->handler)(sess, secured);
+	}
 
-					// expect root object
-					if (!rc || wr.tk(0)->type != Hap::Json::JSMN_OBJECT)
-					{
-						Log::Err("JSON parse error rc %d\n", rc);
-						status = Http::Status::HTTP_400;	// Bad request
-					}
-					else
-					{
-						wr.dump();
+	// POST /identify
+	void Server::_postIdentify(Session* sess, bool& secured)
+	{
+		if (_pairings.Count() == 0)
+		{
+			Log::Msg("Http: Exec unpaired identify\n");
+			sess->rsp.start(Status::HTTP_204);
+			sess->rsp.end();
+		}
+		else
+		{
+			Log::Msg("Http: Unpaired identify prohibited when paired\n");
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.add(ContentType, ContentTypeJson);
+			sess->rsp.end("{\"status\":-70401}");
+		}
+	}
 
-						// simulate success TODO: timed write timer
+	// POST /pair-setup
+	void Server::_postPairSetup(Session* sess, bool& secured)
+	{
+		auto d = sess->req->data();
+		sess->tlvi.parse(d.p(), d.l());
+		Log::Msg("PairSetup: TLV item count %d\n", sess->tlvi.count());
 
-						len = sess->sizeofdata();
-						len = snprintf((char*)sess->data(), len, "{\"status\":0}");
-						status = Http::Status::HTTP_200;
-					}
+		Tlv::State state;
+		if (!sess->tlvi.get(Tlv::Type::State, state))
+		{
+			Log::Msg("PairSetup: State not found\n");
+			return;
+		}
 
-					Log::Msg("Prepare: Status %d  '%.*s'\n", status, len, sess->data());
+		switch (state)
+		{
+		case Tlv::State::M1:
+			_pairSetup1(sess);
+			break;
 
-					sess->rsp.start(status);
-					if (len > 0)
-					{
-						sess->rsp.add(ContentType, ContentTypeJson);
-						sess->rsp.end((const char*)sess->data(), len);
-					}
-					else
-					{
-						sess->rsp.end();
-					}
-				}
-			}
+		case Tlv::State::M3:
+			_pairSetup3(sess);
+			break;
+
+		case Tlv::State::M5:
+			_pairSetup5(sess);
+			break;
 
+		default:
+			Log::Err("PairSetup: Unknown state %d\n", (int)state);
+		}
+	}
+
+	// POST /pair-verify
+	void Server::_postPairVerify(Session* sess, bool& secured)
+	{
+		auto d = sess->req->data();
+		sess->tlvi.parse(d.p(), d.l());
+		Log::Msg("PairVerify: TLV item count %d\n", sess->tlvi.count());
+
+		Tlv::State state;
+		if (!sess->tlvi.get(Tlv::Type::State, state))
+		{
+			Log::Err("PairVerify: State not found\n");
+			return;
+		}
+
+		switch (state)
+		{
+		case Tlv::State::M1:
+		{
+			// resume previous session if the controller asks for it,
+			//	otherwise (or when it cannot be resumed) do full Pair Verify
+			Tlv::Method method;
+			if (sess->tlvi.get(Tlv::Type::Method, method) && method == Tlv::Method::Resume &&
+				_pairResume1(sess))
+				secured = true;
 			else
+				_pairVerify1(sess);
+			break;
+		}
+
+		case Tlv::State::M3:
+			_pairVerify3(sess);
+			secured = sess->ios != nullptr;
+			break;
+		default:
+			Log::Err("PairVerify: Unknown state %d\n", (int)state);
+		}
+	}
+
+	// POST /pairings
+	void Server::_postPairings(Session* sess, bool& secured)
+	{
+		auto d = sess->req->data();
+		sess->tlvi.parse(d.p(), d.l());
+		Log::Msg("Pairings: TLV item count %d\n", sess->tlvi.count());
+
+		Tlv::State state;
+		if (!sess->tlvi.get(Tlv::Type::State, state))
+		{
+			Log::Err("Pairings: State not found\n");
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.end();
+			return;
+		}
+
+		if (state != Tlv::State::M1)
+		{
+			Log::Err("Pairings: Invalid State\n");
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.end();
+			return;
+		}
+
+		Tlv::Method method;
+		if (!sess->tlvi.get(Tlv::Type::Method, method))
+		{
+			Log::Err("Pairings: Method not found\n");
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.end();
+			return;
+		}
+
+		switch (method)
+		{
+		case Tlv::Method::AddPairing:
+			_pairingAdd(sess);
+			break;
+
+		case Tlv::Method::RemovePairing:
+			_pairingRemove(sess);
+			break;
+
+		case Tlv::Method::ListPairing:
+			_pairingList(sess);
+			break;
+		default:
+			Log::Err("Pairings: Unknown method\n");
+			sess->rsp.start(Status::HTTP_400);
+			sess->rsp.end();
+		}
+	}
+
+	// GET /accessories
+	void Server::_getAccessories(Session* sess, bool& secured)
+	{
+		// the response is streamed by _send
+		sess->rsp.start(Status::HTTP_200);
+		sess->rsp.add(ContentType, ContentTypeJson);
+		sess->body = &Server::_accessories;
+	}
+
+	// GET /characteristics?<query>
+	void Server::_getCharacteristics(Session* sess, bool& secured)
+	{
+		auto p = sess->req->path();
+		const char* q = p.p() + 16;
+		int ql = p.l() - 16;
+		if (ql > 0)		// skip '?'
+		{
+			q++;
+			ql--;
+		}
+
+		Hap::Json::Writer w((char*)sess->data(), sess->sizeofdata());
+		auto status = _db.Read(sess->Sid(), q, ql, w);
+		int len = w.len();
+
+		Log::Msg("Read: Status %d  '%.*s'\n", status, len, sess->data());
+
+		sess->rsp.start(status);
+		if (len > 0)
+		{
+			sess->rsp.add(ContentType, ContentTypeJson);
+			sess->rsp.end((const char*)sess->data(), len);
+		}
+		else
+		{
+			sess->rsp.end();
+		}
+	}
+
+	// PUT /characteristics
+	//	the writes are already executed by _writeData while the request data arrived
+	void Server::_putCharacteristics(Session* sess, bool& secured)
+	{
+		auto& w = *sess->wr;
+		Hap::Http::Status status;
+
+		w.out.end_arr().end_obj();
+
+		if (w.bad)
+			status = Http::Status::HTTP_400;	// Bad request
+		else if (w.err == 0)
+			status = Http::Status::HTTP_204;	// No content
+		else if (!w.out.ok())
+			status = Http::Status::HTTP_500;	// Internal error
+		else if (w.err == w.cnt)
+			status = Http::Status::HTTP_400;	// all writes completed with error
+		else
+			status = Http::Status::HTTP_207;	// Multi-status
+
+		Log::Msg("Write: Status %d  characteristics %d  errors %d\n", status, w.cnt, w.err);
+
+		sess->rsp.start(status);
+		if (!w.bad && w.out.ok() && w.err > 0)
+		{
+			// the statuses are streamed by _send
+			sess->rsp.add(ContentType, ContentTypeJson);
+			sess->body = &Server::_writeStatus;
+		}
+		else
+		{
+			sess->rsp.end();
+		}
+	}
+
+	// PUT /prepare
+	void Server::_putPrepare(Session* sess, bool& secured)
+	{
+		auto d = sess->req->data();
+		Log::Msg("Http: %.*s\n", d.l(), d.p());
+
+		Hap::Json::Parser& wr{ *sess->wrParser };
+		wr.init();
+		int rc = wr.parse((const char*)d.p(), d.l());
+		Log::Msg("parse = %d\n", rc);
+
+		Hap::Http::Status status;
+		int len = 0;
+
+		// expect root object
+		if (!rc || wr.tk(0)->type != Hap::Json::JSMN_OBJECT)
+		{
+			Log::Err("JSON parse error rc %d\n", rc);
+			status = Http::Status::HTTP_400;	// Bad request
+		}
+		else
+		{
+			wr.dump();
+
+			// simulate success TODO: timed write timer
+
+			Hap::Json::Writer w((char*)sess->data(), sess->sizeofdata());
+			w.obj().key("status").val(0).end_obj();
+			len = w.len();
+			status = Http::Status::HTTP_200;
+		}
+
+		Log::Msg("Prepare: Status %d  '%.*s'\n", status, len, sess->data());
+
+		sess->rsp.start(status);
+		if (len > 0)
+		{
+			sess->rsp.add(ContentType, ContentTypeJson);
+			sess->rsp.end((const char*)sess->data(), len);
+		}
+		else
+		{
+			sess->rsp.end();
+		}
+	}
+
+	bool Server::Parked(sid_t sid)
+	{
+		if (sid > sid_max)
+			return false;
+
+		return _sess[sid].done != nullptr;
+	}
+
+	void Server::Resume(sid_t sid, Send send)
+	{
+		if (!Parked(sid))
+			return;
+
+		Session* sess = &_sess[sid];
+		if (!cryptoPool.Ready(sid))
+			return;
+
+		// complete the response in buffers taken from the pool,
+		//	when the pool is exhausted the session stays parked and is resumed on next call
+		if (!_acquire(sess, 0))
+			return;
+
+		cryptoPool.Done(sid);
+		Done done = sess->done;
+		sess->done = nullptr;
+
+		sess->Init();
+		(this->*done)(sess);
+
+		_send(sess, send);
+		_release(sess);
+
+		// Pair Verify M4 secures the session after the response is sent
+		if (sess->ios != nullptr)
+			sess->secured = true;
+		Log::Msg("Http::Resume exit Ses %d  secured %d\n", sid, sess->secured);
+	}
+
+	void Server::Poll(sid_t sid, Send send)
+	{
+		Session* sess = &_sess[sid];
+		if (!sess->secured || sess->done != nullptr)
+			return;
+
+		if (!_acquire(sess, 0))
+			return;
+
+		sess->Init();
+
+		Hap::Json::Writer w((char*)sess->data(), sess->sizeofdata());
+		auto status = _db.getEvents(sid, w);
+		int len = w.len();
+
+		if (status == Status::HTTP_200 && len != 0)
+		{
+			Log::Msg("Events: sid %d  '%.*s'\n", sid, len, sess->data());
+
+			sess->rsp.event(status);
+			sess->rsp.add(ContentType, ContentTypeJson);
+			sess->rsp.end((const char*)sess->data(), len);
+
+			_send(sess, send);
+		}
+
+		_release(sess);
+	}
+
+	bool Server::_send(Session* sess, Send& send)
+	{
+		if (sess->body == nullptr)
+		{
+			// send response buffer in blocks
+			const uint8_t *p = (uint8_t*)sess->rsp.buf();
+			uint16_t len = sess->rsp.len();				// data length
+
+			if (!sess->secured)
+				return _sendBlock(sess, send, p, len);
+
+			while (len > 0)
 			{
-				Log::Err("Http: Unknown path %.*s\n", p.l(), p.p());
-				sess->rsp.start(Status::HTTP_400);
-				sess->rsp.end();
+				uint16_t l = len;
+				if (l > MaxHttpBlock)
+					l = MaxHttpBlock;
+
+				if (!_sendBlock(sess, send, p, l))
+					return false;
+
+				len -= l;
+				p += l;
 			}
+
+			return true;
 		}
 
-		if (!_send(sess, send))
+		// streaming response - the body is generated once and sent in chunked transfer coding,
+		//	so its length is not needed in advance and the data cannot change between passes,
+		//	headers followed by the chunks are collected in first MaxHttpBlock bytes of the
+		//	response buffer, each block is sent when full
+		Body body = sess->body;
+		sess->body = nullptr;
+
+		sess->rsp.add(TransferEncoding, "chunked");
+		sess->rsp.end();
+
+		uint8_t* blk = (uint8_t*)sess->rsp.buf();
+		uint16_t len = sess->rsp.len();
+
+		auto put = [&](const char* s, int l) -> bool {
+			while (l > 0)
+			{
+				uint16_t n = MaxHttpBlock - len;
+				if (n > l)
+					n = l;
+
+				memcpy(blk + len, s, n);
+				len += n;
+				s += n;
+				l -= n;
+
+				if (len == MaxHttpBlock)
+				{
+					if (!_sendBlock(sess, send, blk, len))
+						return false;
+					len = 0;
+				}
+			}
+			return true;
+		};
+
+		// each piece of the body is one chunk, the last chunk has zero size
+		int rc = (this->*body)(sess, [&](const char* s, int l) -> bool {
+			if (l == 0)
+				return true;
+
+			char size[12];
+			int n = snprintf(size, sizeof(size), "%x\r\n", l);
+			return put(size, n) && put(s, l) && put("\r\n", 2);
+		});
+
+		if (rc < 0 || !put("0\r\n\r\n", 5))
 			return false;
 
-		sess->secured = secured;
-		Log::Msg("Http::Process exit Ses %d  secured %d\n", sid, sess->secured);
+		if (len > 0)
+			return _sendBlock(sess, send, blk, len);
 
 		return true;
 	}
 
-	void Server::Poll(sid_t sid, Send send)
+	// send one block of response, encrypt it when the session is secured
+	//	block length is limited by MaxHttpBlock in secured session
+	bool Server::_sendBlock(Session* sess, Send& send, const uint8_t* p, uint16_t len)
 	{
-		Session* sess = &_sess[sid];
 		if (!sess->secured)
-			return;
+		{
+			//send response as is
+			return send(sess->Sid(), (char*)p, len) >= 0;
+		}
+
+		uint16_t aad = len;		// block length, and AAD for encryption
+
+		// make 96-bit nonce from send sequential number
+		uint8_t nonce[12];
+		memset(nonce, 0, sizeof(nonce));
+		memcpy(nonce + 4, &sess->sendSeq, 8);
+
+		// encrypt into sess->data buffer which must be >= MaxHttpFrame
+		uint8_t* b = sess->data();
+
+		// copy data length into output buffer
+		b[0] = aad & 0xFF;
+		b[1] = (aad >> 8) & 0xFF;
+
+		Crypto::Aead aead(Crypto::Aead::Encrypt,
+			b + 2, b + 2 + aad,					// output data and tag positions
+			sess->AccessoryToControllerKey,		// encryption key
+			nonce,
+			p, aad,								// data to encrypt
+			b, 2								// aad
+		);
+
+		sess->sendSeq++;
 
-		int len = sess->sizeofdata();
-		auto status = _db.getEvents(sid, (char*)sess->data(), len);
+		// send encrypted block
+		return send(sess->Sid(), (char*)b, 2 + aad + 16) >= 0;
+	}
+
+	// GET /accessories data
+	//	the database is rendered after the first block of the response buffer,
+	//	each time the rest of the buffer is full its data is passed to out
+	int Server::_accessories(Session* sess, const Out& out)
+	{
+		Hap::Json::Writer w(sess->rsp.buf() + MaxHttpBlock, sess->rspSize() - MaxHttpBlock, out);
+		_db.getDb(sess->Sid(), w);
+		if (!w.flush())
+		{
+			Log::Err("Http: accessories data is not sent\n");
+			return -1;
+		}
+
+		return (int)w.total();
+	}
+
+	// start PUT /characteristics request which data is processed while it arrives
+	bool Server::_writeStart(Session* sess)
+	{
+		// statuses are collected after first MaxHttpBlock bytes of the response buffer,
+		//	the response headers are created there when the statuses are sent
+		auto& w = *sess->wr;
+		w.bad = false;
+		w.cnt = w.err = 0;
+		w.out = Hap::Json::Writer(sess->rsp.buf() + MaxHttpBlock, sess->rspSize() - MaxHttpBlock);
+		w.out.obj().arr("characteristics");
+		w.split.init("characteristics");
+
+		return true;
+	}
 
-		if (status != Status::HTTP_200)
-			return;
+	// process next piece of PUT /characteristics data, each complete characteristic is written
+	//	returns number of consumed bytes, the last piece is always consumed
+	uint16_t Server::_writeData(Session* sess, const char* js, uint16_t len, bool last)
+	{
+		auto& w = *sess->wr;
+		if (w.bad)
+			return len;
 
-		if (len == 0)
-			return;
+		int n = w.split.scan(js, len, [this, sess](const char* s, int l) -> bool {
+			return _writeChr(sess, s, l);
+		});
 
-		Log::Msg("Events: sid %d  '%.*s'\n", sid, len, sess->data());
+		if (n < 0)
+		{
+			Log::Err("Http: invalid characteristics data\n");
+			w.bad = true;
+			return len;
+		}
 
-		sess->rsp.event(status);
-		sess->rsp.add(ContentType, ContentTypeJson);
-		sess->rsp.end((const char*)sess->data(), len);
+		if (last && (n < len || !w.split.done()))
+		{
+			Log::Err("Http: characteristics data is incomplete\n");
+			w.bad = true;
+			return len;
+		}
 
-		_send(sess, send);
+		return (uint16_t)n;
 	}
 
-	bool Server::_send(Session* sess, Send& send)
+	// write one characteristic object and append its status
+	bool Server::_writeChr(Session* sess, const char* js, int len)
 	{
-		if (sess->secured)
-		{
-			// session secured - encrypt data
-			const uint8_t *p = (uint8_t*)sess->rsp.buf();
-			uint16_t len = sess->rsp.len();				// data length
-				
-			while (len > 0)
-			{
-				uint16_t aad = len;		// block length, and AAD for encryption
+		Log::Msg("Http: %.*s\n", len, js);
 
-				if (aad > MaxHttpBlock)
-					aad = MaxHttpBlock;
+		Hap::Json::Parser& wr{ *sess->wrParser };
+		wr.init();
+		if (!wr.parse(js, len))
+		{
+			Log::Err("JSON parse error\n");
+			return false;
+		}
 
-				// make 96-bit nonce from send sequential number
-				uint8_t nonce[12];
-				memset(nonce, 0, sizeof(nonce));
-				memcpy(nonce + 4, &sess->sendSeq, 8);
+		Obj::wr_prm p = { wr };
+		if (!_db.Write(sess->Sid(), wr, 0, p))
+			return false;
 
-				// encrypt into sess->data buffer which must be >= MaxHttpFrame
-				uint8_t* b = sess->data();
+		auto& w = *sess->wr;
+		w.cnt++;
+		if (p.status != Hap::Status::Success)
+			w.err++;
 
-				// copy data length into output buffer
-				b[0] = aad & 0xFF;
-				b[1] = (aad >> 8) & 0xFF;
+		w.out.obj();
+		w.out.key("aid").val(p.aid);
+		w.out.key("iid").val(p.iid);
+		w.out.key("status").lit(Hap::StatusStr(p.status));
+		w.out.end_obj();
 
-				Crypto::Aead aead(Crypto::Aead::Encrypt,
-					b + 2, b + 2 + aad,					// output data and tag positions
-					sess->AccessoryToControllerKey,		// encryption key
-					nonce,
-					p, aad,								// data to encrypt
-					b, 2								// aad
-				);
+		return true;
+	}
 
-				sess->sendSeq++;
+	// statuses of streamed PUT /characteristics request
+	int Server::_writeStatus(Session* sess, const Out& out)
+	{
+		const char* s = sess->rsp.buf() + MaxHttpBlock;
+		if (!out(s, sess->wr->out.len()))
+			return -1;
 
-				// send encrypted block
-				send(sess->Sid(), (char*)b, 2 + aad + 16);
+		return sess->wr->out.len();
+	}
 
-				len -= aad;
-				p += aad;
-			}
-		}
-		else
-		{
-			//send response as is
-			send(sess->Sid(), sess->rsp.buf(), sess->rsp.len());
-		}
+	// run crypto work on worker pool and park the session,
+	//	or run it inline and complete the response when the pool is not running
+	void Server::_offload(Session* sess, std::function<void(Srp::Ctx& ctx)> work, Done done)
+	{
+		sess->done = done;
+		if (cryptoPool.Submit(sess->Sid(), work))
+			return;
 
-		return true;
+		sess->done = nullptr;
+		work(srpCtx);
+		(this->*done)(sess);
 	}
 
+	// start TLV response
+	void Server::_tlvStart(Session* sess, Tlv::State state)
+	{
+		// prepare response without data
+		sess->rsp.start(Status::HTTP_200);
+		sess->rsp.add(ContentType, ContentTypeTlv8);
+		sess->rsp.add(ContentLength, 0);
+		sess->rsp.end();
+
+		// create response TLV in the response buffer right after HTTP headers 
+		sess->tlvo.create((uint8_t*)sess->rsp.data(), sess->rsp.size());
+		sess->tlvo.add(Hap::Tlv::Type::State, state);
+	}
 
 	void Server::_pairSetup1(Session* sess)
 	{
@@ -747,13 +1669,29 @@ namespace Hap::Http
 
 		srp_auth_count++;
 
-		// init new verifier	// TODO: store salt and verifier in config data
-		ver.init(Username, Hap::config->setupCode);
+		// verifier is restored by Start, again only when the setup code has been provisioned or reset since
+		if (!srpRestore())
+		{
+			Log::Err("PairSetupM1: no SRP verifier\n");
+			srpClose(sess->Sid());
+			goto RetErr;
+		}
 		Log::Hex("Srp.I", ver.I, (uint32_t)strlen(ver.I));
 		Log::Hex("Srp.p", ver.p, (uint32_t)strlen(ver.p));
 		Log::Hex("Srp.s", ver.s, Srp::SRP_SALT_BYTES);
 
-		srp.init();
+		// use precalculated (b, B) if it is ready and matches the verifier
+		{
+			Srp::Host::Ephemeral e;
+			if (srpPrecalc.Take(e) && srp.init(e))
+				Log::Msg("PairSetupM1: precalculated B\n");
+			else if (!srp.init(srpCtx))
+			{
+				Log::Err("PairSetupM1: B calculation error\n");
+				srpClose(sess->Sid());
+				goto RetErr;
+			}
+		}
 
 		Log::Hex("Srp.B", srp.getB(), Srp::SRP_PUBLIC_BYTES);
 
@@ -772,23 +1710,13 @@ namespace Hap::Http
 	
 	void Server::_pairSetup3(Session* sess)
 	{
-		uint8_t* iosKey = sess->data();
-		uint16_t iosKey_size = Srp::SRP_PUBLIC_BYTES;
-		uint8_t* iosProof = iosKey + Srp::SRP_PUBLIC_BYTES;
-		uint16_t iosProof_size = Srp::SRP_PROOF_BYTES;
+		uint8_t* iosKey = srpA;
+		uint16_t iosKey_size = sizeof(srpA);
+		uint8_t* iosProof = srpM;
+		uint16_t iosProof_size = sizeof(srpM);
 
 		Log::Msg("PairSetupM3\n");
 
-		// prepare response without data
-		sess->rsp.start(Status::HTTP_200);
-		sess->rsp.add(ContentType, ContentTypeTlv8);
-		sess->rsp.add(ContentLength, 0);
-		sess->rsp.end();
-
-		// create response TLV in the response buffer right after HTTP headers 
-		sess->tlvo.create((uint8_t*)sess->rsp.data(), sess->rsp.size());
-		sess->tlvo.add(Hap::Tlv::Type::State, Hap::Tlv::State::M4);
-
 		// verify that pairing is in progress on current session
 		if (!srp.active(sess->Sid()))
 		{
@@ -811,37 +1739,58 @@ namespace Hap::Http
 		}
 		Log::Hex("iosProof", iosProof, iosProof_size);
 
-		srp.setA(iosKey);
+		// calculate shared key and verify iOS proof on crypto worker
+		_offload(sess, [sess, iosProof_size](Srp::Ctx& ctx) -> void {
 
-		Crypto::HkdfSha512(
-			(const uint8_t*)"Pair-Setup-Encrypt-Salt", sizeof("Pair-Setup-Encrypt-Salt") - 1,
-			srp.getK(), Srp::SRP_KEY_BYTES,
-			(const uint8_t*)"Pair-Setup-Encrypt-Info", sizeof("Pair-Setup-Encrypt-Info") - 1,
-			sess->key, sizeof(sess->key)
-		);
-		Log::Hex("SessKey", sess->key, sizeof(sess->key));
+			if (!srp.setA(ctx, srpA))
+			{
+				Log::Err("PairSetupM3: S calculation error\n");
+				srpVerified = false;
+				return;
+			}
 
-		if (!srp.verify(iosProof, iosProof_size))
-		{
-			Log::Err("PairSetupM3: SRP verify error\n");
-			sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Authentication);
-			goto Ret;
-		}
+			Crypto::HkdfSha512(
+				(const uint8_t*)"Pair-Setup-Encrypt-Salt", sizeof("Pair-Setup-Encrypt-Salt") - 1,
+				srp.getK(), Srp::SRP_KEY_BYTES,
+				(const uint8_t*)"Pair-Setup-Encrypt-Info", sizeof("Pair-Setup-Encrypt-Info") - 1,
+				sess->key, sizeof(sess->key)
+			);
 
-		uint8_t V[Srp::SRP_PROOF_BYTES];
-		srp.getV(V);
-		Log::Hex("Response", V, sizeof(V));
+			srpVerified = srp.verify(srpM, iosProof_size);
 
-		sess->tlvo.add(Hap::Tlv::Type::Proof, V, Srp::SRP_PROOF_BYTES);
+		}, &Server::_pairSetup3Done);
 
-		goto Ret;
+		return;
 
 	RetErr:	// error, cancel current pairing, if this session owns it
-		if (srp.active(sess->Sid()))
-			srp.close(sess->Sid());
+		srpClose(sess->Sid());
+		_tlvStart(sess, Hap::Tlv::State::M4);
 		sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Unknown);
 
-	Ret:
+		// adjust content length in response
+		sess->rsp.setContentLength(sess->tlvo.length());
+	}
+
+	void Server::_pairSetup3Done(Session* sess)
+	{
+		_tlvStart(sess, Hap::Tlv::State::M4);
+
+		Log::Hex("SessKey", sess->key, sizeof(sess->key));
+
+		if (!srpVerified)
+		{
+			Log::Err("PairSetupM3: SRP verify error\n");
+			sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Authentication);
+		}
+		else
+		{
+			uint8_t V[Srp::SRP_PROOF_BYTES];
+			srp.getV(V);
+			Log::Hex("Response", V, sizeof(V));
+
+			sess->tlvo.add(Hap::Tlv::Type::Proof, V, Srp::SRP_PROOF_BYTES);
+		}
+
 		// adjust content length in response
 		sess->rsp.setContentLength(sess->tlvo.length());
 	}
@@ -853,19 +1802,10 @@ namespace Hap::Http
 		uint8_t* iosTlv;		// decrypted TLV
 		uint8_t* srvTag;		// calculated tag
 		uint16_t iosTlv_size;
+		Hap::Tlv::Error err = Hap::Tlv::Error::Unknown;
 
 		Log::Msg("PairSetupM5\n");
 
-		// prepare response without data
-		sess->rsp.start(Status::HTTP_200);
-		sess->rsp.add(ContentType, ContentTypeTlv8);
-		sess->rsp.add(ContentLength, 0);
-		sess->rsp.end();
-
-		// create response TLV in the response buffer right after HTTP headers 
-		sess->tlvo.create((uint8_t*)sess->rsp.data(), sess->rsp.size());
-		sess->tlvo.add(Hap::Tlv::Type::State, Hap::Tlv::State::M6);
-
 		// verify that pairing is in progress on current session
 		if (!srp.active(sess->Sid()))
 		{
@@ -906,7 +1846,7 @@ namespace Hap::Http
 			if (memcmp(iosTag, srvTag, 16) != 0)
 			{
 				Log::Err("PairSetupM5: authTag does not match\n");
-				sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Authentication);
+				err = Hap::Tlv::Error::Authentication;
 				goto Ret;
 			}
 
@@ -942,77 +1882,91 @@ namespace Hap::Http
 			if (!_pairings.Add(id, ltpk, Controller::Perm::Admin))
 			{
 				Log::Err("PairSetupM5: cannot add Pairing record\n");
-				sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::MaxPeers);
+				err = Hap::Tlv::Error::MaxPeers;
 				goto Ret;
 			}
 
-			// buid Accessory Info and sign it
-			uint8_t* AccesoryInfo = sess->data();	// re-use sess->data buffer
-			uint8_t* p = AccesoryInfo;
-			int l = sess->sizeofdata();
+			// buid Accessory Info and sign it on crypto worker
+			_offload(sess, [this, sess](Srp::Ctx& ctx) -> void {
 
-			// add AccessoryX
-			Crypto::HkdfSha512(
-				(const uint8_t*)"Pair-Setup-Accessory-Sign-Salt", sizeof("Pair-Setup-Accessory-Sign-Salt") - 1,
-				srp.getK(), Srp::SRP_KEY_BYTES,
-				(const uint8_t*)"Pair-Setup-Accessory-Sign-Info", sizeof("Pair-Setup-Accessory-Sign-Info") - 1,
-				p, 32);
-			p += 32;
-			l -= 32;
-				
-			// add Accessory PairingId
-			memcpy(p, config->deviceId, strlen(config->deviceId));
-			p += (uint32_t)strlen(config->deviceId);
-			l -= (uint32_t)strlen(config->deviceId);
-
-			// add Accessory LTPK
-			memcpy(p, _keys.pubKey(), _keys.PUBKEY_SIZE_BYTES);
-			p += _keys.PUBKEY_SIZE_BYTES;
-			l -= _keys.PUBKEY_SIZE_BYTES;
-
-			// sign the info
-			_keys.sign(p, AccesoryInfo, (uint16_t)(p - AccesoryInfo));
-			p += _keys.SIGN_SIZE_BYTES;
-			l -= _keys.SIGN_SIZE_BYTES;
-
-			// construct the sub-TLV
-			Hap::Tlv::Create subTlv;
-			subTlv.create(p, l);
-			subTlv.add(Hap::Tlv::Type::Identifier, (const uint8_t*)config->deviceId, (uint16_t)strlen(config->deviceId));
-			subTlv.add(Hap::Tlv::Type::PublicKey, _keys.pubKey(), _keys.PUBKEY_SIZE_BYTES);
-			subTlv.add(Hap::Tlv::Type::Signature, p - _keys.SIGN_SIZE_BYTES, _keys.SIGN_SIZE_BYTES);
-			p += subTlv.length();
-			l -= subTlv.length();
-
-			// enrypt AccessoryInfo using session key
-			Crypto::Aead(Crypto::Aead::Encrypt,
-				p,									// output encrypted TLV 
-				p + subTlv.length(),				// output tag follows the encrypted TLV
-				sess->key,						
-				(const uint8_t *)"\x00\x00\x00\x00PS-Msg06",
-				p - subTlv.length(),				// input TLV
-				subTlv.length()						// TLV length
-			);
+				uint8_t AccesoryInfo[32 + 32 + 32];
+				uint8_t* p = AccesoryInfo;
+				uint32_t l = (uint32_t)strlen(config->deviceId);
+
+				// add AccessoryX
+				Crypto::HkdfSha512(
+					(const uint8_t*)"Pair-Setup-Accessory-Sign-Salt", sizeof("Pair-Setup-Accessory-Sign-Salt") - 1,
+					srp.getK(), Srp::SRP_KEY_BYTES,
+					(const uint8_t*)"Pair-Setup-Accessory-Sign-Info", sizeof("Pair-Setup-Accessory-Sign-Info") - 1,
+					p, 32);
+				p += 32;
 
-			l -= subTlv.length() + 16;
-			Log::Msg("PairSetupM5: sess->data unused: %d\n", l);
+				// add Accessory PairingId
+				if (l > 32)
+					l = 32;
+				memcpy(p, config->deviceId, l);
+				p += l;
 
-			// add encryped info and tag to output TLV
-			sess->tlvo.add(Hap::Tlv::Type::EncryptedData, p, subTlv.length() + 16);
+				// add Accessory LTPK
+				memcpy(p, _keys.pubKey(), _keys.PUBKEY_SIZE_BYTES);
+				p += _keys.PUBKEY_SIZE_BYTES;
 
-			Hap::config->Update();
+				// sign the info
+				_keys.sign(sess->sign, AccesoryInfo, (uint16_t)(p - AccesoryInfo));
 
-			goto RetDone;	// pairing complete
+			}, &Server::_pairSetup5Done);
+
+			return;
 		}
 
 	RetErr:	// error, cancel current pairing, if this session owns it
-		sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Unknown);
-
-	RetDone:
-		if (srp.active(sess->Sid()))
-			srp.close(sess->Sid());
+		srpClose(sess->Sid());
 
 	Ret:
+		_tlvStart(sess, Hap::Tlv::State::M6);
+		sess->tlvo.add(Hap::Tlv::Type::Error, err);
+
+		// adjust content length in response
+		sess->rsp.setContentLength(sess->tlvo.length());
+	}
+
+	void Server::_pairSetup5Done(Session* sess)
+	{
+		_tlvStart(sess, Hap::Tlv::State::M6);
+
+		uint8_t* p = sess->data();
+		int l = sess->sizeofdata();
+
+		// construct the sub-TLV
+		Hap::Tlv::Create subTlv;
+		subTlv.create(p, l);
+		subTlv.add(Hap::Tlv::Type::Identifier, (const uint8_t*)config->deviceId, (uint16_t)strlen(config->deviceId));
+		subTlv.add(Hap::Tlv::Type::PublicKey, _keys.pubKey(), _keys.PUBKEY_SIZE_BYTES);
+		subTlv.add(Hap::Tlv::Type::Signature, sess->sign, _keys.SIGN_SIZE_BYTES);
+		p += subTlv.length();
+		l -= subTlv.length();
+
+		// enrypt AccessoryInfo using session key
+		Crypto::Aead(Crypto::Aead::Encrypt,
+			p,									// output encrypted TLV 
+			p + subTlv.length(),				// output tag follows the encrypted TLV
+			sess->key,						
+			(const uint8_t *)"\x00\x00\x00\x00PS-Msg06",
+			p - subTlv.length(),				// input TLV
+			subTlv.length()						// TLV length
+		);
+
+		l -= subTlv.length() + 16;
+		Log::Msg("PairSetupM5: sess->data unused: %d\n", l);
+
+		// add encryped info and tag to output TLV
+		sess->tlvo.add(Hap::Tlv::Type::EncryptedData, p, subTlv.length() + 16);
+
+		Hap::config->Update();
+
+		// pairing complete
+		srpClose(sess->Sid());
+
 		// adjust content length in response
 		sess->rsp.setContentLength(sess->tlvo.length());
 	}
@@ -1020,71 +1974,79 @@ namespace Hap::Http
 	void Server::_pairVerify1(Session* sess)
 	{
 		Hap::Tlv::Item iosKey;
-		const uint8_t* sharedSecret;
-		uint8_t* p;
-		size_t l;
 
 		Log::Msg("PairVerifyM1\n");
 
-		// prepare response without data
-		sess->rsp.start(Status::HTTP_200);
-		sess->rsp.add(ContentType, ContentTypeTlv8);
-		sess->rsp.add(ContentLength, 0);
-		sess->rsp.end();
-
-		// create response TLV in the response buffer right after HTTP headers 
-		sess->tlvo.create((uint8_t*)sess->rsp.data(), sess->rsp.size());
-		sess->tlvo.add(Hap::Tlv::Type::State, Hap::Tlv::State::M2);
-
 		// verify that PublicKey is present in input TLV
-		if (!sess->tlvi.get(Tlv::Type::PublicKey, iosKey))
+		if (!sess->tlvi.get(Tlv::Type::PublicKey, iosKey) || iosKey.l() != sizeof(sess->peerKey))
 		{
 			Log::Err("PairVerifyM1: PublicKey not found\n");
 			goto RetErr;
 		}
+		memcpy(sess->peerKey, iosKey.p(), sizeof(sess->peerKey));
 
-		// create new Curve25519 key pair
-		sess->curve.init();
+		// create session keys and sign AccessoryInfo on crypto worker
+		_offload(sess, [this, sess](Srp::Ctx& ctx) -> void {
 
-		// generate shared secret
-		sharedSecret = sess->curve.sharedSecret(iosKey.p());
+			// create new Curve25519 key pair
+			sess->curve.init();
 
-		// create session key from shared secret
-		Crypto::HkdfSha512(
-			(const uint8_t*)"Pair-Verify-Encrypt-Salt", sizeof("Pair-Verify-Encrypt-Salt") - 1,
-			sharedSecret, sess->curve.KEY_SIZE_BYTES,
-			(const uint8_t*)"Pair-Verify-Encrypt-Info", sizeof("Pair-Verify-Encrypt-Info") - 1,
-			sess->key, sizeof(sess->key));
-
-		// construct AccessoryInfo
-		p = sess->data();
-		l = sess->sizeofdata();
-
-		//	add Curve25519 public key
-		memcpy(p, sess->curve.pubKey(), sess->curve.KEY_SIZE_BYTES);
-		p += sess->curve.KEY_SIZE_BYTES;
-		l -= sess->curve.KEY_SIZE_BYTES;
-
-		//	add Accessory PairingId
-		memcpy(p, config->deviceId, strlen(config->deviceId));
-		p += strlen(config->deviceId);
-		l -= strlen(config->deviceId);
-
-		// add iOS device public key
-		memcpy(p, iosKey.p(), iosKey.l());
-		p += iosKey.l();
-		l -= iosKey.l();
-
-		// sign the AccessoryInfo
-		_keys.sign(p, sess->data(), (uint16_t)(p - sess->data()));
-		p += _keys.SIGN_SIZE_BYTES;
-		l -= _keys.SIGN_SIZE_BYTES;
+			// generate shared secret
+			const uint8_t* sharedSecret = sess->curve.sharedSecret(sess->peerKey);
+
+			// create session key from shared secret
+			Crypto::HkdfSha512(
+				(const uint8_t*)"Pair-Verify-Encrypt-Salt", sizeof("Pair-Verify-Encrypt-Salt") - 1,
+				sharedSecret, sess->curve.KEY_SIZE_BYTES,
+				(const uint8_t*)"Pair-Verify-Encrypt-Info", sizeof("Pair-Verify-Encrypt-Info") - 1,
+				sess->key, sizeof(sess->key));
+
+			// construct AccessoryInfo
+			uint8_t AccesoryInfo[32 + 32 + 32];
+			uint8_t* p = AccesoryInfo;
+			uint32_t l = (uint32_t)strlen(config->deviceId);
+
+			//	add Curve25519 public key
+			memcpy(p, sess->curve.pubKey(), sess->curve.KEY_SIZE_BYTES);
+			p += sess->curve.KEY_SIZE_BYTES;
+
+			//	add Accessory PairingId
+			if (l > 32)
+				l = 32;
+			memcpy(p, config->deviceId, l);
+			p += l;
+
+			// add iOS device public key
+			memcpy(p, sess->peerKey, sizeof(sess->peerKey));
+			p += sizeof(sess->peerKey);
+
+			// sign the AccessoryInfo
+			_keys.sign(sess->sign, AccesoryInfo, (uint16_t)(p - AccesoryInfo));
+
+		}, &Server::_pairVerify1Done);
+
+		return;
+
+	RetErr:	// error
+		_tlvStart(sess, Hap::Tlv::State::M2);
+		sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Unknown);
+
+		// adjust content length in response
+		sess->rsp.setContentLength(sess->tlvo.length());
+	}
+
+	void Server::_pairVerify1Done(Session* sess)
+	{
+		_tlvStart(sess, Hap::Tlv::State::M2);
+
+		uint8_t* p = sess->data();
+		size_t l = sess->sizeofdata();
 
 		// make sub-TLV
 		Hap::Tlv::Create subTlv;
 		subTlv.create(p, (uint16_t)l);
 		subTlv.add(Hap::Tlv::Type::Identifier, (const uint8_t*)config->deviceId, (uint16_t)strlen(config->deviceId));
-		subTlv.add(Hap::Tlv::Type::Signature, p - _keys.SIGN_SIZE_BYTES, _keys.SIGN_SIZE_BYTES);
+		subTlv.add(Hap::Tlv::Type::Signature, sess->sign, _keys.SIGN_SIZE_BYTES);
 		p += subTlv.length();
 		l -= subTlv.length();
 
@@ -1107,12 +2069,6 @@ namespace Hap::Http
 		// add encryped info and tag to output TLV
 		sess->tlvo.add(Hap::Tlv::Type::EncryptedData, p, subTlv.length() + 16);
 
-		goto Ret;
-
-	RetErr:	// error
-		sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Unknown);
-
-	Ret:
 		// adjust content length in response
 		sess->rsp.setContentLength(sess->tlvo.length());
 	}
@@ -1124,19 +2080,10 @@ namespace Hap::Http
 		uint8_t* iosTlv;		// decrypted TLV
 		uint8_t* srvTag;		// calculated tag
 		uint16_t iosTlv_size;
+		Hap::Tlv::Error err = Hap::Tlv::Error::Unknown;
 
 		Log::Msg("PairVerifyM3\n");
 
-		// prepare response without data
-		sess->rsp.start(Status::HTTP_200);
-		sess->rsp.add(ContentType, ContentTypeTlv8);
-		sess->rsp.add(ContentLength, 0);
-		sess->rsp.end();
-
-		// create response TLV in the response buffer right after HTTP headers 
-		sess->tlvo.create((uint8_t*)sess->rsp.data(), sess->rsp.size());
-		sess->tlvo.add(Hap::Tlv::Type::State, Hap::Tlv::State::M4);
-
 		// extract encrypted data into sess->data buffer
 		iosEncrypted = sess->data();
 		iosTlv_size = sess->sizeofdata();
@@ -1169,8 +2116,8 @@ namespace Hap::Http
 			if (memcmp(iosTag, srvTag, 16) != 0)
 			{
 				Log::Err("PairVerifyM3: authTag does not match\n");
-				sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Authentication);
-				goto Ret;
+				err = Hap::Tlv::Error::Authentication;
+				goto RetErr;
 			}
 
 			// parse decrypted TLV - 2 items expected
@@ -1197,37 +2144,165 @@ namespace Hap::Http
 			if (ios == nullptr)
 			{
 				Log::Err("PairVerifyM3: iOS device ID not found\n");
-				sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Authentication);
-				goto Ret;
+				err = Hap::Tlv::Error::Authentication;
+				goto RetErr;
 			}
 
 			// TODO: construct iOSDeviceInfo and verify signature
 
-			// create session encryption keys
-			Crypto::HkdfSha512(
-				(const uint8_t*)"Control-Salt", sizeof("Control-Salt") - 1,
-				sess->curve.sharedSecret(), sess->curve.KEY_SIZE_BYTES,
-				(const uint8_t*)"Control-Read-Encryption-Key", sizeof("Control-Read-Encryption-Key") - 1,
-				sess->AccessoryToControllerKey, sizeof(sess->AccessoryToControllerKey));
-
-			Crypto::HkdfSha512(
-				(const uint8_t*)"Control-Salt", sizeof("Control-Salt") - 1,
-				sess->curve.sharedSecret(), sess->curve.KEY_SIZE_BYTES,
-				(const uint8_t*)"Control-Write-Encryption-Key", sizeof("Control-Write-Encryption-Key") - 1,
-				sess->ControllerToAccessoryKey, sizeof(sess->ControllerToAccessoryKey));
-
 			// mark session as secured after response is sent
 			sess->ios = ios;
 
-			goto Ret;
+			// create session encryption keys and resume session ID on crypto worker
+			_offload(sess, [this, sess](Srp::Ctx& ctx) -> void {
+
+				memcpy(sess->secret, sess->curve.sharedSecret(), sizeof(sess->secret));
+
+				_sessionKeys(sess);
+
+				Crypto::HkdfSha512(
+					(const uint8_t*)"Pair-Verify-ResumeSessionID-Salt", sizeof("Pair-Verify-ResumeSessionID-Salt") - 1,
+					sess->secret, sizeof(sess->secret),
+					(const uint8_t*)"Pair-Verify-ResumeSessionID-Info", sizeof("Pair-Verify-ResumeSessionID-Info") - 1,
+					sess->resumeId, sizeof(sess->resumeId));
+
+			}, &Server::_pairVerify3Done);
+
+			return;
 		}
 
 	RetErr:	// error
-		sess->tlvo.add(Hap::Tlv::Type::Error, Hap::Tlv::Error::Unknown);
+		_tlvStart(sess, Hap::Tlv::State::M4);
+		sess->tlvo.add(Hap::Tlv::Type::Error, err);
+
+		// adjust content length in response
+		sess->rsp.setContentLength(sess->tlvo.length());
+	}
+
+	void Server::_pairVerify3Done(Session* sess)
+	{
+		_tlvStart(sess, Hap::Tlv::State::M4);
+
+		// the session may be resumed on next connection
+		resumeCache.Add(sess->ios, sess->resumeId, sess->secret);
+
+		// adjust content length in response
+		sess->rsp.setContentLength(sess->tlvo.length());
+	}
+
+	// Pair Resume M1 - resume session verified earlier
+	//	returns false when the session cannot be resumed, the request is then handled as Pair Verify M1
+	bool Server::_pairResume1(Session* sess)
+	{
+		Hap::Tlv::Item iosKey;
+		Hap::Tlv::Item id;
+		Hap::Tlv::Item enc;
+		ResumeCache::Entry e;
+		const Controller* ios;
+		uint8_t salt[32 + ResumeCache::IdLen];	// controller public key | session ID
+		uint8_t newId[ResumeCache::IdLen];
+		uint8_t key[32];
+		uint8_t tag[16];
+
+		Log::Msg("PairResumeM1\n");
+
+		if (!sess->tlvi.get(Tlv::Type::PublicKey, iosKey) || iosKey.l() != 32 ||
+			!sess->tlvi.get(Tlv::Type::SessionID, id) || id.l() != ResumeCache::IdLen ||
+			!sess->tlvi.get(Tlv::Type::EncryptedData, enc) || enc.l() != sizeof(tag))
+		{
+			Log::Err("PairResumeM1: invalid request\n");
+			return false;
+		}
+
+		// the session ID is sent in clear, the cached session is replaced only after the auth tag is verified
+		if (!resumeCache.Find(id.p(), e))
+		{
+			Log::Msg("PairResumeM1: session not found\n");
+			goto RetErr;
+		}
+
+		// controller must still be paired
+		ios = _pairings.Get(Tlv::Item(e.ios, e.iosLen));
+		if (ios == nullptr)
+		{
+			Log::Msg("PairResumeM1: controller not paired\n");
+			resumeCache.Remove(e.ios, e.iosLen);
+			resumeCache.miss++;
+			goto RetErr;
+		}
+
+		// verify request: auth tag of empty data encrypted by request key
+		memcpy(salt, iosKey.p(), 32);
+		memcpy(salt + 32, id.p(), ResumeCache::IdLen);
+		Crypto::HkdfSha512(
+			salt, sizeof(salt),
+			e.secret, sizeof(e.secret),
+			(const uint8_t*)"Pair-Resume-Request-Info", sizeof("Pair-Resume-Request-Info") - 1,
+			key, sizeof(key));
+		Crypto::Aead(Crypto::Aead::Decrypt, nullptr, tag, key, (const uint8_t *)"\x00\x00\x00\x00PR-Msg01", nullptr, 0);
+
+		if (memcmp(tag, enc.p(), sizeof(tag)) != 0)
+		{
+			Log::Err("PairResumeM1: authTag does not match\n");
+			resumeCache.miss++;
+			goto RetErr;
+		}
+
+		// new session ID, response key and shared secret
+		Crypto::rnd_data(newId, sizeof(newId));
+		memcpy(salt + 32, newId, sizeof(newId));
+
+		Crypto::HkdfSha512(
+			salt, sizeof(salt),
+			e.secret, sizeof(e.secret),
+			(const uint8_t*)"Pair-Resume-Response-Info", sizeof("Pair-Resume-Response-Info") - 1,
+			key, sizeof(key));
+		Crypto::Aead(Crypto::Aead::Encrypt, nullptr, tag, key, (const uint8_t *)"\x00\x00\x00\x00PR-Msg02", nullptr, 0);
+
+		Crypto::HkdfSha512(
+			salt, sizeof(salt),
+			e.secret, sizeof(e.secret),
+			(const uint8_t*)"Pair-Resume-Shared-Secret-Info", sizeof("Pair-Resume-Shared-Secret-Info") - 1,
+			sess->secret, sizeof(sess->secret));
+		memset(e.secret, 0, sizeof(e.secret));
+
+		_sessionKeys(sess);
+
+		// mark session as secured after response is sent
+		sess->ios = ios;
+		resumeCache.Add(ios, newId, sess->secret);
+		resumeCache.hit++;
+		resumeCache.log();
+
+		_tlvStart(sess, Hap::Tlv::State::M2);
+		sess->tlvo.add(Hap::Tlv::Type::SessionID, newId, sizeof(newId));
+		sess->tlvo.add(Hap::Tlv::Type::EncryptedData, tag, sizeof(tag));
 
-	Ret:
 		// adjust content length in response
 		sess->rsp.setContentLength(sess->tlvo.length());
+
+		return true;
+
+	RetErr:
+		memset(e.secret, 0, sizeof(e.secret));
+		resumeCache.log();
+		return false;
+	}
+
+	// derive session encryption keys from shared secret
+	void Server::_sessionKeys(Session* sess)
+	{
+		Crypto::HkdfSha512(
+			(const uint8_t*)"Control-Salt", sizeof("Control-Salt") - 1,
+			sess->secret, sizeof(sess->secret),
+			(const uint8_t*)"Control-Read-Encryption-Key", sizeof("Control-Read-Encryption-Key") - 1,
+			sess->AccessoryToControllerKey, sizeof(sess->AccessoryToControllerKey));
+
+		Crypto::HkdfSha512(
+			(const uint8_t*)"Control-Salt", sizeof("Control-Salt") - 1,
+			sess->secret, sizeof(sess->secret),
+			(const uint8_t*)"Control-Write-Encryption-Key", sizeof("Control-Write-Encryption-Key") - 1,
+			sess->ControllerToAccessoryKey, sizeof(sess->ControllerToAccessoryKey));
 	}
 
 	void Server::_pairingAdd(Session* sess)
@@ -1349,6 +2424,9 @@ namespace Hap::Http
 			goto RetErr;
 		}
 
+		// removed controller cannot resume its sessions
+		resumeCache.Remove(id.p(), id.l());
+
 		Hap::config->Update();
 
 		// TODO: close all sessions to removed controller
@@ -8,6 +8,9 @@
 
 #include "picohttpparser.h"
 
+#include <array>
+#include <string>
+
 namespace Hap::Http
 {
 	enum class Status : uint8_t
@@ -24,49 +27,90 @@ namespace Hap::Http
 		HTTP_500,	// on an accessory server error, e.g.the operation timed out.
 		HTTP_503	// if the accessory server is too busy to service the request, e.g. reached its	maximum number of connections.
 	};
-	static const char* StatusStr(Status c)
+
+	// constant text with its length
+	struct Text
 	{
-		static const char* const str[] =
-		{
-			"200 OK",
-			"204 No Content",
-			"207 Multi-Status",
-			"400 Bad Request",
-			"404 Not Found",
-			//"405 Method Not Allowed",
-			"422 Unprocessable Entry",
-			//"429 Too Many requests",
-			"470 Connection Authorization Required",
-			"500 Internal Server Error",
-			"503 Service Unavailable",
-		};
-		return str[int(c)];
-	}
+		const char* s;
+		uint16_t l;
+
+		template<size_t N> constexpr Text(const char(&str)[N]) : s(str), l(N - 1) {}
+	};
+
+	// response status lines, indexed by Status
+	static constexpr Text StatusLine[] =
+	{
+		"HTTP/1.1 200 OK\r\n",
+		"HTTP/1.1 204 No Content\r\n",
+		"HTTP/1.1 207 Multi-Status\r\n",
+		"HTTP/1.1 400 Bad Request\r\n",
+		"HTTP/1.1 404 Not Found\r\n",
+		//"HTTP/1.1 405 Method Not Allowed\r\n",
+		"HTTP/1.1 422 Unprocessable Entry\r\n",
+		//"HTTP/1.1 429 Too Many requests\r\n",
+		"HTTP/1.1 470 Connection Authorization Required\r\n",
+		"HTTP/1.1 500 Internal Server Error\r\n",
+		"HTTP/1.1 503 Service Unavailable\r\n",
+	};
+
+	// event status lines, indexed by Status
+	static constexpr Text EventLine[] =
+	{
+		"EVENT/1.0 200 OK\r\n",
+		"EVENT/1.0 204 No Content\r\n",
+		"EVENT/1.0 207 Multi-Status\r\n",
+		"EVENT/1.0 400 Bad Request\r\n",
+		"EVENT/1.0 404 Not Found\r\n",
+		"EVENT/1.0 422 Unprocessable Entry\r\n",
+		"EVENT/1.0 470 Connection Authorization Required\r\n",
+		"EVENT/1.0 500 Internal Server Error\r\n",
+		"EVENT/1.0 503 Service Unavailable\r\n",
+	};
+
+	static_assert(sizeofarr(StatusLine) == int(Status::HTTP_503) + 1, "StatusLine does not match Status");
+	static_assert(sizeofarr(EventLine) == int(Status::HTTP_503) + 1, "EventLine does not match Status");
 
 	enum Header
 	{
 		ContentType,
 		ContentLength,
+		TransferEncoding,
 
 		HeaderMax
 	};
+
+	// header names, indexed by Header
+	static constexpr Text HeaderName[] =
+	{
+		"Content-Type",
+		"Content-Length",
+		"Transfer-Encoding",
+	};
+	static_assert(sizeofarr(HeaderName) == HeaderMax, "HeaderName does not match Header");
+
 	static const char* HeaderStr(Header h)
 	{
-		static const char* const str[] =
-		{
-			"Content-Type",
-			"Content-Length"
-		};
-		return str[int(h)];
+		return HeaderName[int(h)].s;
 	}
 
 	extern const char* ContentTypeJson;
 	extern const char* ContentTypeTlv8;
+	extern const char* Username;
+
+	// header lines of the content types above
+	static constexpr Text ContentTypeJsonLine = "Content-Type: application/hap+json\r\n";
+	static constexpr Text ContentTypeTlv8Line = "Content-Type: application/pairing+tlv8\r\n";
+
+	// Content-Length header with fixed width value, so the value can be set after the data is created
+	static constexpr Text ContentLengthLine = "Content-Length: 00000\r\n";
+	constexpr uint8_t ContentLengthWidth = 5;
 
 	// Http request parser
 	template<int MaxHeaders>
 	class Parser
 	{
+		static_assert(MaxHeaders < 255, "header index does not fit uint8_t");
+
 	private:
 		char *_buf;			// buffer containing decrypted HTTP request
 		uint16_t _size;		// request buffer size
@@ -78,7 +122,10 @@ namespace Hap::Http
 		uint32_t _method_len;
 		uint32_t _path_len;
 		uint32_t _data_len;
+		uint32_t _length;		// length of the request, headers and data
+		uint32_t _hdr_len;		// length of the request headers
 		uint32_t _num_headers;
+		uint8_t _hdr_idx[HeaderMax];	// known headers: index in _headers + 1, 0 if the header is absent
 		uint32_t _buflen;
 		uint32_t _prevbuflen;
 		int _minor_version;
@@ -89,6 +136,7 @@ namespace Hap::Http
 			Error = -1,
 			Success = 0,
 			Incomplete = 1,
+			Headers = 2,		// headers are parsed, data is incomplete
 		};
 
 		void init(char *buf, uint16_t size)
@@ -100,6 +148,9 @@ namespace Hap::Http
 			_num_headers = 0;
 			_buflen = 0;
 			_prevbuflen = 0;
+			_length = 0;
+			_hdr_len = 0;
+			memset(_hdr_idx, 0, sizeof(_hdr_idx));
 		}
 
 		char* buf()
@@ -126,8 +177,22 @@ namespace Hap::Http
 
 			if (rc > 0)
 			{
+				index();
+
+				// the request data is defined by Content-Length,
+				//	data that follows belongs to next request
+				int len = 0;
+				if (!hdr(ContentLength, len) || len < 0)
+					len = 0;
+
 				_data = (uint8_t*)_buf + rc;
-				_data_len = _buflen - rc;
+				_data_len = len;
+				_length = rc + len;
+				_hdr_len = rc;
+
+				if (_buflen - rc < (uint32_t)len)
+					return Headers;
+
 				return Success;
 			}
 				
@@ -152,6 +217,45 @@ namespace Hap::Http
 			return Buf(_data, _data_len);
 		}
 
+		// length of parsed request
+		uint32_t length()
+		{
+			return _length;
+		}
+
+		// length of request headers
+		uint32_t hdrLength()
+		{
+			return _hdr_len;
+		}
+
+		// request data was copied into bigger buffer
+		void move(char* buf, uint16_t size)
+		{
+			if (_hdr_len != 0)
+			{
+				_method = buf + (_method - _buf);
+				_path = buf + (_path - _buf);
+				_data = (uint8_t*)buf + (_data - (uint8_t*)_buf);
+				for (uint32_t i = 0; i < _num_headers; i++)
+				{
+					_headers[i].name = buf + (_headers[i].name - _buf);
+					_headers[i].value = buf + (_headers[i].value - _buf);
+				}
+			}
+
+			_buf = buf;
+			_size = size;
+		}
+
+		// n bytes of request data were processed and removed from the buffer (streamed request)
+		void consume(uint32_t n)
+		{
+			_data_len -= n;
+			_length -= n;
+			_buflen -= n;
+		}
+
 		uint32_t hdr_count()
 		{
 			return _num_headers;
@@ -174,47 +278,68 @@ namespace Hap::Http
 		// return true if header h exists, and value of integer parameter
 		bool hdr(Header h, int& prm)
 		{
-			for (uint32_t i = 0; i < _num_headers; i++)
+			uint32_t i = _hdr_idx[h];
+			if (i-- == 0)
+				return false;
+
+			char v[16];
+			if (_headers[i].value_len >= sizeof(v))
 			{
-				const char* s = HeaderStr(h);
+				Log::Err("Http: %s is too big\n", HeaderStr(h));
+				return false;
+			}
 
-				if (strlen(s) == _headers[i].name_len && 
-					memcmp(_headers[i].name, s, _headers[i].name_len) == 0)
-				{
-					char v[16];
-					if (_headers[i].value_len < sizeof(v))
-					{
-						memcpy(v, _headers[i].value, _headers[i].value_len);
-						v[_headers[i].value_len] = 0;
+			memcpy(v, _headers[i].value, _headers[i].value_len);
+			v[_headers[i].value_len] = 0;
 
-						prm = atoi(v);
-						return true;
-					}
-					else
-					{
-						Log::Err("Http: %s is too big\n", s);
-					}
-				}
-			}
-			return false;
+			prm = atoi(v);
+			return true;
 		}
 
 		// returns true if header h exists and its value matches prm
 		bool hdr(Header h, const char* prm)
 		{
-			for (uint32_t i = 0; i < _num_headers; i++)
+			uint32_t i = _hdr_idx[h];
+			if (i-- == 0)
+				return false;
+
+			uint32_t l = (uint32_t)strlen(prm);
+			return l == _headers[i].value_len &&
+				memcmp(prm, _headers[i].value, l) == 0;
+		}
+
+	private:
+		// header names are case-insensitive, known names consist of letters and '-' only,
+		//	so setting bit 5 of both sides folds the case
+		static bool match(const phr_header& ph, const Text& name)
+		{
+			if (ph.name_len != name.l)
+				return false;
+
+			for (uint16_t i = 0; i < name.l; i++)
 			{
-				const char* s = HeaderStr(h);
+				if ((ph.name[i] | 0x20) != (name.s[i] | 0x20))
+					return false;
+			}
+			return true;
+		}
+
+		// one pass over parsed headers, the first one of each known name is indexed
+		void index()
+		{
+			memset(_hdr_idx, 0, sizeof(_hdr_idx));
 
-				if (strlen(s) == _headers[i].name_len &&
-					memcmp(_headers[i].name, s, _headers[i].name_len) == 0)
+			for (uint32_t i = 0; i < _num_headers; i++)
+			{
+				for (uint8_t h = 0; h < HeaderMax; h++)
 				{
-					uint32_t l = (uint32_t)strlen(prm);
-					return l == _headers[i].value_len &&
-						memcmp(prm, _headers[i].value, l) == 0;
+					if (_hdr_idx[h] == 0 && match(_headers[i], HeaderName[h]))
+					{
+						_hdr_idx[h] = uint8_t(i + 1);
+						break;
+					}
 				}
 			}
-			return false;
 		}
 
 	};
@@ -224,6 +349,7 @@ namespace Hap::Http
 	{
 	private:
 		char* _buf = nullptr;
+		uint16_t _size = 0;
 		uint16_t _max = 0;
 		uint16_t _len = 0;
 		uint16_t _len_pos = 0;
@@ -232,7 +358,10 @@ namespace Hap::Http
 		void init(char* buf, uint16_t size)
 		{
 			_buf = buf;
+			_size = size;
 			_max = size;
+			_len = 0;
+			_len_pos = 0;
 		}
 
 		// return response buffer
@@ -263,16 +392,12 @@ namespace Hap::Http
 
 		bool start(Status status)
 		{
-			_len = snprintf(_buf, _max, "HTTP/1.1 %s\r\n", StatusStr(status));
-			_max -= _len;
-			return _max != 0;
+			return line(StatusLine[int(status)]);
 		}
 
 		bool event(Status status)
 		{
-			_len = snprintf(_buf, _max, "EVENT/1.0 %s\r\n", StatusStr(status));
-			_max -= _len;
-			return _max != 0;
+			return line(EventLine[int(status)]);
 		}
 
 		// add header with integer parameter
@@ -281,18 +406,18 @@ namespace Hap::Http
 			if (_max == 0)
 				return false;
 
-			int l = 0;
-
-			l = snprintf(_buf + _len, _max, "%s: %4d\r\n", HeaderStr(h), prm);
-			_len += l;
-			_max -= _len;
-
-			if (h == ContentLength)
+			if (h == ContentLength && (unsigned)prm < 100000 && ContentLengthLine.l < _max)
 			{
+				memcpy(_buf + _len, ContentLengthLine.s, ContentLengthLine.l);
+				_len += ContentLengthLine.l;
+				_max -= ContentLengthLine.l;
 				_len_pos = _len - 2;
+				digits(_buf + _len_pos - ContentLengthWidth, prm);
+				return _max != 0;
 			}
 
-			return _max != 0;
+			int l = snprintf(_buf + _len, _max, "%s: %4d\r\n", HeaderStr(h), prm);
+			return advance(l);
 		}
 
 		// add length of data area
@@ -302,9 +427,7 @@ namespace Hap::Http
 			if (_len_pos == 0)
 				return;
 
-			char t = _buf[_len_pos];
-			snprintf(_buf + _len_pos - 4, 6, "%4d", len);
-			_buf[_len_pos] = t;
+			digits(_buf + _len_pos - ContentLengthWidth, len);
 
 			_len += len;
 		}
@@ -314,11 +437,13 @@ namespace Hap::Http
 			if (_max == 0)
 				return false;
 
-			int l = 0;
-			l = snprintf(_buf + _len, _max, "%s: %s\r\n", HeaderStr(h), prm);
-			_len += l;
-			_max -= _len;
-			return _max != 0;
+			if (h == ContentType && prm == ContentTypeJson)
+				return line(ContentTypeJsonLine, _len);
+			if (h == ContentType && prm == ContentTypeTlv8)
+				return line(ContentTypeTlv8Line, _len);
+
+			int l = snprintf(_buf + _len, _max, "%s: %s\r\n", HeaderStr(h), prm);
+			return advance(l);
 		}
 
 		// end HTTP response with no data
@@ -327,10 +452,7 @@ namespace Hap::Http
 			if (_max == 0)
 				return false;
 
-			int l = snprintf(_buf + _len, _max, "\r\n");
-			_len += l;
-			_max -= l;
-			return _max != 0;
+			return line("\r\n", _len);
 		}
 
 		// end HTTP response, attach data from string
@@ -343,10 +465,68 @@ namespace Hap::Http
 				l = (uint32_t)strlen(s);
 			if (!add(ContentLength, l))
 				return false;
-			l = snprintf(_buf + _len, _max, "\r\n%s", s);
+			if (l + 2 >= _max)
+				return false;
+
+			_buf[_len] = '\r';
+			_buf[_len + 1] = '\n';
+			memcpy(_buf + _len + 2, s, l);
+			_len += l + 2;
+			_max -= l + 2;
+			return _max != 0;
+		}
+
+	private:
+		// copy constant text at position pos, text at pos starts the response
+		bool line(const Text& t, uint16_t pos = 0)
+		{
+			if (pos == 0)
+			{
+				_max = _size;
+				_len_pos = 0;
+			}
+
+			if (t.l >= _max)
+				return false;
+
+			memcpy(_buf + pos, t.s, t.l);
+			_len = pos + t.l;
+			_max -= t.l;
+			return true;
+		}
+
+		// account for l bytes written by snprintf
+		bool advance(int l)
+		{
+			if (l < 0 || l >= _max)
+			{
+				_max = 0;
+				return false;
+			}
+
 			_len += l;
 			_max -= l;
-			return _max != 0;
+			return true;
+		}
+
+		// write v into ContentLengthWidth chars, right aligned and padded with spaces
+		//	the digits are computed unconditionally, leading zeros are masked into spaces
+		static void digits(char* s, uint32_t v)
+		{
+			uint8_t d[ContentLengthWidth];
+			for (int i = ContentLengthWidth - 1; i >= 0; i--)
+			{
+				d[i] = uint8_t(v % 10);
+				v /= 10;
+			}
+
+			uint8_t lead = 1;
+			for (int i = 0; i < ContentLengthWidth - 1; i++)
+			{
+				lead &= uint8_t(d[i] == 0);
+				s[i] = char('0' + d[i] - lead * ('0' - ' '));
+			}
+			s[ContentLengthWidth - 1] = char('0' + d[ContentLengthWidth - 1]);
 		}
 	};
 
@@ -355,29 +535,67 @@ namespace Hap::Http
 	class Server
 	{
 	public:
+		// buffers of one request, taken from the pool
 		struct Buf
 		{
-			Hap::Buf<char> req;	// request buffer MaxHttpFrame*N where N depends on expected request size
-			Hap::Buf<char> rsp;	// response buffer  MaxHttpFrame*M where M depends on expected response size
-			Hap::Buf<char> tmp;	// temporary storage (encrypt/decrypt etc.), MaxHttpFrame
-
-
+			Hap::Buf<char> req;	// request buffer
+			Hap::Buf<char> rsp;	// response buffer
+			Hap::Buf<char> tmp;	// temporary storage (encrypt/decrypt etc.)
 		};
 
+		// buffer sizes requested from the pool,
+		//	the pool must have a class for each of them and a bigger class for requests that do not fit ReqSize,
+		//	the ReqSize class needs MaxHttpSessions + 1 blocks: each session may keep a request buffer
+		//	with pipelined data, and the processed request needs one more for temporary storage
+		static constexpr uint16_t ReqSize = MaxHttpFrame;		// initial request buffer
+		static constexpr uint16_t RspSize = MaxHttpFrame * 4;	// response buffer
+		static constexpr uint16_t TmpSize = MaxHttpFrame;		// temporary storage
+
 	private:
-		Buf& _buf;
+		BufPool& _pool;				// request buffers
 		Db& _db;					// accessory database
 		Pairings& _pairings;		// pairings database
 		Crypto::Ed25519& _keys;		// crypto keys
 
+		class Session;
+		using Done = void (Server::*)(Session* sess);	// completion of a parked request
+
+		// streamed response data
+		//	the body is generated once and passes the data to out in arbitrary pieces,
+		//	returns data length or -1 on error
+		using Out = std::function<bool(const char* s, int l)>;
+		using Body = int (Server::*)(Session* sess, const Out& out);
+
+		// PUT /characteristics executed while its data arrives
+		struct Write
+		{
+			bool bad;						// malformed request
+			uint16_t cnt;					// characteristics written
+			uint16_t err;					// characteristics written with error status
+			Hap::Json::Writer out;			// statuses in response buffer
+			Hap::Json::Splitter split;		// splits the characteristics array into objects
+		};
+
+		// request parsing state, needed only while a request is processed,
+		//	shared by sessions and taken for one request together with the pool buffers
+		struct Scratch
+		{
+			Parser<MaxHttpHeaders> req;
+			Hap::Json::ParserStatic<MaxHttpJson> wrParser;
+			Write wr;
+			bool used = false;
+		} _scratch[MaxHttpRequests];
+
 		class Session				// sessions
 		{
 		public:
 			// the following fields are valid during one HTTP request/response exchange
-			Parser<MaxHttpHeaders> req;			// HTTP request
+			Parser<MaxHttpHeaders>* req = nullptr;	// HTTP request
 			Response rsp;						// HTTP response
 			Hap::Tlv::Parse<MaxHttpTlv> tlvi;	// incoming TLV parser
 			Hap::Tlv::Create tlvo;				// outgoing TLV creator
+			Hap::Json::Parser* wrParser = nullptr;	// json parser for PUT, one characteristic at a time
+			Write* wr = nullptr;				// PUT /characteristics state
 				
 			// session-wide data
 			Crypto::Curve25519 curve;			// Session securiry keys (used on Pair Verivication phase)
@@ -385,22 +603,34 @@ namespace Hap::Http
 			bool secured;						// session is secured
 			uint8_t AccessoryToControllerKey[32];
 			uint8_t ControllerToAccessoryKey[32];
+			uint8_t secret[32];					// shared secret of the verified session, session keys are derived from it
 			uint64_t recvSeq;
 			uint64_t sendSeq;
-			Hap::Json::ParserStatic<200> wrParser;	// json parser for PUT, allocates storage for 200 tokens TODO: some other way
+			uint16_t holdLen;					// data received after last request (pipelining), kept in buf.req until next Process
+			uint16_t holdPlain;					// length of decrypted data at hold start, encrypted data follows
 
 			// session temp data
 			uint8_t key[32];
-
-			void Open(sid_t sid, Buf* buf)
+			uint8_t peerKey[32];				// controller Curve25519 public key (Pair Verify M1)
+			uint8_t sign[64];					// accessory signature calculated by crypto worker
+			uint8_t resumeId[8];				// Pair Resume session ID calculated by crypto worker
+			Done done = nullptr;				// request parked on crypto worker, completes the response
+			Body body = nullptr;				// response data generated while the response is sent
+			Buf buf;							// buffers taken from the pool for current request
+			Scratch* scratch = nullptr;			// request parsing state taken for current request
+
+			void Open(sid_t sid)
 			{
 				_sid = sid;
-				_buf = buf;
 				_opened = true;
 				ios = nullptr;
 				secured = false;
 				recvSeq = 0;
 				sendSeq = 0;
+				holdLen = 0;
+				holdPlain = 0;
+				done = nullptr;
+				body = nullptr;
 			}
 
 			void Close()
@@ -409,6 +639,9 @@ namespace Hap::Http
 				_sid = sid_invalid;
 				ios = nullptr;
 				secured = false;
+				holdLen = 0;
+				holdPlain = 0;
+				done = nullptr;
 			}
 
 			bool isOpen()
@@ -419,8 +652,8 @@ namespace Hap::Http
 			void Init(
 			)
 			{
-				req.init(_buf->req.p(), _buf->req.l());
-				rsp.init(_buf->rsp.p(), _buf->rsp.l());
+				req->init(buf.req.p(), (uint16_t)buf.req.l());
+				rsp.init(buf.rsp.p(), (uint16_t)buf.rsp.l());
 			}
 
 			sid_t Sid()
@@ -432,30 +665,48 @@ namespace Hap::Http
 
 			uint8_t* data()
 			{
-				return (uint8_t*)_buf->tmp.p();
+				return (uint8_t*)buf.tmp.p();
 			}
 
 			uint16_t sizeofdata()
 			{
-				return (uint16_t)_buf->tmp.l();
+				return (uint16_t)buf.tmp.l();
+			}
+
+			// size of response buffer
+			uint16_t rspSize()
+			{
+				return (uint16_t)buf.rsp.l();
 			}
 
 		private:
 			// the following fields are valid from session open to close
 			bool _opened = false;		// true when session is opened
 			sid_t _sid = sid_invalid;	// valid when opened
-			Buf* _buf = nullptr;
 		} _sess[MaxHttpSessions + 1];	// last slot is for handling 'too many sessions' condition
 
+		// per-session data is kept resident for all sessions, request parsing state is in Scratch
+		static constexpr size_t SessionBudget = 640;
+		static_assert(sizeof(Session) <= SessionBudget, "Session exceeds its memory budget");
+
 	public:
 		using Recv = std::function<int(sid_t sid, char* buf, uint16_t size)>;
 		using Send = std::function<int(sid_t sid, char* buf, uint16_t len)>;
+		using Wake = std::function<void()>;
 
 
-		Server(Buf& buf, Db& db, Pairings& pairings, Crypto::Ed25519& keys)
-			: _buf(buf), _db(db), _pairings(pairings), _keys(keys)
+		Server(BufPool& pool, Db& db, Pairings& pairings, Crypto::Ed25519& keys)
+			: _pool(pool), _db(db), _pairings(pairings), _keys(keys)
 		{}
 
+		// Start/Stop - start/stop server background tasks
+		//	the caller (network task) calls Start before the first Open
+		//	and Stop after the last Close
+		//	'wake' is called from a crypto worker thread when a parked session
+		//	is ready to be resumed, the network task must then call Resume
+		void Start(Wake wake = nullptr);
+		void Stop();
+
 		// Open - returns new session ID, 0..sid_max, or sid_invalid
 		//	the caller (network task) calls Open when new TCP connection request arrives
 		//	when sid_invalid is returned, the caller should still call Process
@@ -486,14 +737,113 @@ namespace Hap::Http
 		//	for all opened sessions so events get delivered to all connected controllers
 		void Poll(sid_t sid, Send send);
 
+		// Parked - returns true while the session waits for crypto worker
+		//	the network task must not read from parked session
+		bool Parked(sid_t sid);
+
+		// Resume - send the response of a parked session if its crypto operation is complete
+		//	the network task calls this for parked sessions after 'wake' was signaled,
+		//	and on each pass of its loop since the session stays parked while the buffer pool is exhausted
+		void Resume(sid_t sid, Send send);
+
 	private:
+		// receive state of Process, offsets in the request buffer
+		struct Rx
+		{
+			uint16_t len = 0;		// received data
+			uint16_t pos = 0;		// start of received data not decrypted yet
+			uint16_t plain = 0;		// decrypted data at buffer start
+			uint16_t hdr = 0;		// length of headers of streamed request
+			uint32_t left = 0;		// data of streamed request not processed yet
+			bool stream = false;	// request data is processed while it arrives
+		};
+
+		// request routing
+		//	the handler is called when the request passes checks of its route,
+		//	secured is set when the session becomes secured after the response is sent
+		using Handler = void (Server::*)(Session* sess, bool& secured);
+		using Stream = bool (Server::*)(Session* sess);
+
+		enum RouteCheck : uint8_t
+		{
+			RouteSecured = 1,		// secured session is required
+			RouteTlv8 = 2,			// TLV8 content and Content-Length are required
+			RouteJson = 4,			// JSON content and Content-Length are required
+		};
+
+		struct Route
+		{
+			const char* method;
+			const char* path;		// path without query
+			uint8_t mlen;
+			uint8_t plen;
+			uint8_t check;			// RouteCheck flags
+			Handler handler;
+			Stream start;			// starts processing of request data while it arrives, optional
+
+			constexpr Route(const char* m, const char* p, uint8_t chk, Handler h, Stream st = nullptr)
+				: method(m), path(p),
+				mlen(uint8_t(std::char_traits<char>::length(m))), plen(uint8_t(std::char_traits<char>::length(p))),
+				check(chk), handler(h), start(st)
+			{}
+		};
+
+		static constexpr uint8_t RouteCount = 8;
+		static constexpr uint8_t RouteSlots = 16;		// size of route hash table
+		static const Route _routes[RouteCount];
+		static const std::array<uint8_t, RouteSlots> _routeSlots;	// route index + 1, 0 - empty slot
+
+		// FNV-1a hash of method and path
+		static constexpr uint32_t _routeHash(const char* m, uint16_t ml, const char* p, uint16_t pl)
+		{
+			uint32_t h = 2166136261u;
+			for (uint16_t i = 0; i < ml; i++)
+				h = (h ^ uint8_t(m[i])) * 16777619u;
+			h = (h ^ uint8_t(' ')) * 16777619u;
+			for (uint16_t i = 0; i < pl; i++)
+				h = (h ^ uint8_t(p[i])) * 16777619u;
+			return h;
+		}
+
+		static constexpr std::array<uint8_t, RouteSlots> _routeTable();
+		const Route* _route(Session* sess);
+		Status _check(Session* sess, const Route& r);
+
+		bool _acquire(Session* sess, uint16_t req);
+		void _release(Session* sess);
+		bool _grow(Session* sess, uint16_t len);
+		bool _process(Session* sess, Recv& recv, Send& send);
+		int _recv(Session* sess, Recv& recv, Send& send, Rx& rx, bool wait);
+		void _dispatch(Session* sess, bool& secured);
+		void _postIdentify(Session* sess, bool& secured);
+		void _postPairSetup(Session* sess, bool& secured);
+		void _postPairVerify(Session* sess, bool& secured);
+		void _postPairings(Session* sess, bool& secured);
+		void _getAccessories(Session* sess, bool& secured);
+		void _getCharacteristics(Session* sess, bool& secured);
+		void _putCharacteristics(Session* sess, bool& secured);
+		void _putPrepare(Session* sess, bool& secured);
 		bool _send(Session* sess, Send& send);
-			
+		bool _sendBlock(Session* sess, Send& send, const uint8_t* p, uint16_t len);
+		int _accessories(Session* sess, const Out& out);
+		bool _writeStart(Session* sess);
+		uint16_t _writeData(Session* sess, const char* js, uint16_t len, bool last);
+		bool _writeChr(Session* sess, const char* js, int len);
+		int _writeStatus(Session* sess, const Out& out);
+		void _offload(Session* sess, std::function<void(Srp::Ctx& ctx)> work, Done done);
+		void _tlvStart(Session* sess, Tlv::State state);
+
 		void _pairSetup1(Session* sess);
 		void _pairSetup3(Session* sess);
+		void _pairSetup3Done(Session* sess);
 		void _pairSetup5(Session* sess);
+		void _pairSetup5Done(Session* sess);
 		void _pairVerify1(Session* sess);
+		void _pairVerify1Done(Session* sess);
 		void _pairVerify3(Session* sess);
+		void _pairVerify3Done(Session* sess);
+		bool _pairResume1(Session* sess);
+		void _sessionKeys(Session* sess);
 		void _pairingAdd(Session* sess);
 		void _pairingRemove(Session* sess);
 		void _pairingList(Session* sess);
@@ -10,6 +10,8 @@
 #include <type_traits>
 #include <limits>
 #include <charconv>
+#include <functional>
+#include <cmath>
 
 #ifdef OLD__GNUC__		// GCC is missing from_chars(,,double)
 namespace std
@@ -52,7 +54,7 @@ namespace Hap::Json
 	{
 	protected:
 		const char* _js = nullptr;
-		uint16_t _len = 0;
+		uint32_t _len = 0;
 		jsmntok_t* _tk;
 		int _tk_count;
 		int _cnt = 0;
@@ -269,7 +271,7 @@ namespace Hap::Json
 		}
 
 		// parse JSON-formatted string
-		bool parse(const char* js, uint16_t len)
+		bool parse(const char* js, uint32_t len)
 		{
 			_js = js;
 			_len = len;
@@ -374,12 +376,450 @@ namespace Hap::Json
 	template<int TokenCount>
 	class ParserStatic : public Parser
 	{
+		static_assert(TokenCount <= std::numeric_limits<decltype(jsmntok_t::parent)>::max(), "token index does not fit parent link");
 	private:
 		jsmntok_t _tk[TokenCount];
 
 	public:
 		ParserStatic() : Parser(_tk, TokenCount) {}
 	};
+
+	// incremental splitter of JSON array
+	//	scans JSON text that arrives in pieces and passes each complete object
+	//	of array member <key> of the root object to a callback,
+	//	so the text never has to be kept in memory as a whole
+	class Splitter
+	{
+	public:
+		using Elm = std::function<bool(const char* js, int len)>;
+
+		void init(const char* key)
+		{
+			_key = key;
+			_state = Root;
+			_depth = 0;
+			_str = _esc = false;
+			_km = _cand = _next = false;
+			_kl = 0;
+			_found = false;
+			_off = 0;
+			_elm = -1;
+		}
+
+		// scan next piece of the text
+		//	js points to the first byte not consumed by previous calls,
+		//	elm is called for each complete object of the array, it returns false to abort the scan
+		//	returns number of consumed bytes (all bytes before an incomplete object) or -1 on error
+		int scan(const char* js, int len, const Elm& elm)
+		{
+			for (int i = _off; i < len; i++)
+			{
+				char c = js[i];
+
+				if (_str)
+				{
+					if (_esc)
+						_esc = _km = false;
+					else if (c == '\\')
+						_esc = true;
+					else if (c == '"')
+					{
+						_str = false;
+						if (_depth == 1)
+							_cand = _km && _key[_kl] == 0;
+					}
+					else if (_depth == 1 && _km)
+					{
+						if (_key[_kl] == c)
+							_kl++;
+						else
+							_km = false;
+					}
+					continue;
+				}
+
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+					continue;
+
+				switch (_state)
+				{
+				case Root:
+					if (c != '{')
+						return -1;
+					_state = Member;
+					_depth = 1;
+					continue;
+
+				case Array:
+					if (_depth == 2)
+					{
+						if (c == ',')
+							continue;
+						if (c == ']')
+						{
+							_state = Member;
+							_depth = 1;
+							continue;
+						}
+						if (c != '{')
+							return -1;	// object expected
+						_elm = i;
+					}
+					break;
+
+				case Member:
+					if (_depth == 1)
+					{
+						if (c == '"')
+						{
+							_km = true;
+							_kl = 0;
+						}
+						else if (c == ':')
+						{
+							_next = _cand;
+						}
+						else if (c == '[' && _next)
+						{
+							_state = Array;
+							_depth = 2;
+							_found = true;
+							_next = false;
+							continue;
+						}
+						else
+						{
+							_next = false;
+						}
+						_cand = false;
+					}
+					break;
+
+				case End:
+					return -1;	// data after the root object
+				}
+
+				switch (c)
+				{
+				case '"':
+					_str = true;
+					break;
+
+				case '{':
+				case '[':
+					if (++_depth > MaxDepth)
+						return -1;
+					break;
+
+				case '}':
+				case ']':
+					if (--_depth == 0)
+						_state = End;
+					else if (_depth == 2 && _state == Array)
+					{
+						if (!elm(js + _elm, i + 1 - _elm))
+							return -1;
+						_elm = -1;
+					}
+					break;
+				}
+			}
+
+			// keep incomplete object, it is already scanned up to len
+			int n = _elm < 0 ? len : _elm;
+			_off = len - n;
+			if (_elm >= 0)
+				_elm = 0;
+
+			return n;
+		}
+
+		// root object is complete and the array is found
+		bool done() const
+		{
+			return _state == End && _found;
+		}
+
+	private:
+		static constexpr uint8_t MaxDepth = 16;
+
+		enum State : uint8_t
+		{
+			Root,		// root object is expected
+			Member,		// inside the root object
+			Array,		// inside the array
+			End			// root object is complete
+		};
+
+		const char* _key;
+		State _state;
+		uint8_t _depth;
+		bool _str, _esc;	// inside string, after escape char
+		bool _km;			// string at depth 1 matches the key so far
+		bool _cand;			// last string at depth 1 matches the key
+		bool _next;			// next value is the array
+		bool _found;
+		uint8_t _kl;		// matched key length
+		int _off;			// scan offset, bytes before it are already scanned
+		int _elm;			// start of current array object, -1 if none
+	};
+
+	// JSON writer
+	//	writes JSON text into a fixed buffer, commas between members and array elements
+	//	are inserted by the writer, strings are escaped;
+	//	when the buffer is full its content is passed to spill and the buffer is reused,
+	//	without spill (or when spill fails) the writer stops and ok() returns false
+	class Writer
+	{
+	public:
+		using Spill = std::function<bool(const char* s, int l)>;
+
+		Writer() = default;
+		Writer(char* buf, int size, const Spill& spill = nullptr) : _buf(buf), _size(size), _spill(spill) {}
+
+		// containers
+		Writer& obj()
+		{
+			sep();
+			put('{');
+			_comma = false;
+			return *this;
+		}
+
+		Writer& end_obj()
+		{
+			put('}');
+			_comma = true;
+			return *this;
+		}
+
+		Writer& arr()
+		{
+			sep();
+			put('[');
+			_comma = false;
+			return *this;
+		}
+
+		Writer& end_arr()
+		{
+			put(']');
+			_comma = true;
+			return *this;
+		}
+
+		// member key, the member value must follow
+		Writer& key(const char* k)
+		{
+			sep();
+			put('"');
+			raw(k, (int)strlen(k));
+			put('"');
+			put(':');
+			_comma = false;
+			return *this;
+		}
+
+		// member key and array, the array must be closed by end_arr
+		Writer& arr(const char* k)
+		{
+			return key(k).arr();
+		}
+
+		// typed values
+		Writer& null()
+		{
+			return lit("null", 4);
+		}
+
+		template<typename T> Writer& val(T v)
+		{
+			static_assert(std::is_arithmetic<T>::value, "number or bool expected");
+
+			if constexpr (std::is_same<T, bool>::value)
+				return v ? lit("true", 4) : lit("false", 5);
+			else
+			{
+				char s[32];
+				int l;
+				if constexpr (std::is_floating_point<T>::value)
+					l = flt(s, sizeof(s), v);
+				else
+					l = int(std::to_chars(s, s + sizeof(s), v).ptr - s);
+				return lit(s, l);
+			}
+		}
+
+		Writer& str(const char* v)
+		{
+			return str(v, (int)strlen(v));
+		}
+
+		Writer& str(const char* v, int l)
+		{
+			sep();
+			put('"');
+
+			// copy runs of plain chars, escape the rest
+			int i = 0;
+			while (i < l)
+			{
+				int n = i;
+				while (n < l && plain(v[n]))
+					n++;
+				raw(v + i, n - i);
+				if (n == l)
+					break;
+
+				char c = v[n];
+				if (c == '"' || c == '\\')
+				{
+					char e[2] = { '\\', c };
+					raw(e, 2);
+				}
+				else
+				{
+					static const char hex[] = "0123456789abcdef";
+					char e[6] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF] };
+					raw(e, 6);
+				}
+				i = n + 1;
+			}
+
+			put('"');
+			_comma = true;
+			return *this;
+		}
+
+		// value which is already JSON-formatted (number or literal)
+		Writer& lit(const char* v)
+		{
+			return lit(v, (int)strlen(v));
+		}
+
+		Writer& lit(const char* v, int l)
+		{
+			sep();
+			raw(v, l);
+			_comma = true;
+			return *this;
+		}
+
+		// drop data in the buffer and start over, the data passed to spill cannot be dropped
+		void reset()
+		{
+			_len = 0;
+			_comma = false;
+			_err = false;
+		}
+
+		// pass data left in the buffer to spill, returns ok()
+		bool flush()
+		{
+			if (!_err && _len != 0 && _spill)
+				spill();
+			return ok();
+		}
+
+		// all data fit into the buffer or were passed to spill
+		bool ok() const
+		{
+			return !_err;
+		}
+
+		// length of data in the buffer
+		int len() const
+		{
+			return _len;
+		}
+
+		// total length of written data, including the data passed to spill
+		uint32_t total() const
+		{
+			return _spilled + _len;
+		}
+
+	private:
+		char* _buf = nullptr;
+		int _size = 0;
+		int _len = 0;
+		uint32_t _spilled = 0;
+		bool _comma = false;	// value was written, next value needs comma
+		bool _err = false;
+		Spill _spill;
+
+		// shortest text which reads back to the same value, JSON has no NaN and Infinity
+		template<typename T> static int flt(char* s, int size, T v)
+		{
+			if (!std::isfinite(v))
+			{
+				memcpy(s, "null", 4);
+				return 4;
+			}
+#if defined(__cpp_lib_to_chars)
+			return int(std::to_chars(s, s + size, v).ptr - s);
+#else
+			// no floating to_chars in older GCC, try increasing precision until round-trip
+			static constexpr int digits = std::numeric_limits<T>::max_digits10;
+			int l = 0;
+			for (int p = digits - 2; p <= digits; p++)
+			{
+				l = snprintf(s, size, "%.*g", p, double(v));
+				if (T(strtod(s, nullptr)) == v)
+					break;
+			}
+			return l;
+#endif
+		}
+
+		static bool plain(char c)
+		{
+			return (unsigned char)c >= 0x20 && c != '"' && c != '\\';
+		}
+
+		void sep()
+		{
+			if (_comma)
+				put(',');
+		}
+
+		void put(char c)
+		{
+			if (_err || (_len == _size && !spill()))
+				return;
+			_buf[_len++] = c;
+		}
+
+		void raw(const char* s, int l)
+		{
+			while (l > 0 && !_err)
+			{
+				if (_len == _size && !spill())
+					return;
+
+				int n = _size - _len;
+				if (n > l)
+					n = l;
+				memcpy(_buf + _len, s, n);
+				_len += n;
+				s += n;
+				l -= n;
+			}
+		}
+
+		bool spill()
+		{
+			if (_err || !_spill || !_spill(_buf, _len))
+			{
+				_err = true;
+				return false;
+			}
+
+			_spilled += _len;
+			_len = 0;
+			return true;
+		}
+	};
 }
 
 #endif
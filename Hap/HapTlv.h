@@ -18,6 +18,7 @@ namespace Hap::Tlv
 		AddPairing = 3,
 		RemovePairing = 4,
 		ListPairing = 5,
+		Resume = 6,
 	};
 
 	enum class State : uint8_t
@@ -58,6 +59,7 @@ namespace Hap::Tlv
 		Permissions = 0x0B,		//	integer
 		FragmentData = 0x0C,	//	bytes
 		Fragmentlast = 0x0D,	//	bytes
+		SessionID = 0x0E,		//	bytes
 		Flags = 0x13,			//  integer
 		Separator = 0xFF,		//	null
 		Invalid = 0xFE
@@ -42,13 +42,13 @@ enum jsmnerr {
  * end		end position in JSON data string
  */
 typedef struct {
-	int16_t start;
-	int16_t end;
-	int8_t type;
-	int8_t size;
+	int32_t start;
+	int32_t end;
+	int16_t size;
 #ifdef JSMN_PARENT_LINKS
-	int8_t parent;
+	int16_t parent;
 #endif
+	int8_t type;
 } jsmntok_t;
 
 /**
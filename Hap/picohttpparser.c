@@ -27,13 +27,19 @@
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
-#ifdef __SSE4_2__
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PHR_X86 1
 #ifdef _MSC_VER
-#include <nmmintrin.h>
+#include <intrin.h>
+#include <immintrin.h>
 #else
 #include <x86intrin.h>
 #endif
 #endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PHR_NEON 1
+#include <arm_neon.h>
+#endif
 #include "picohttpparser.h"
 
 /* $Id: 1b172063e1b60ba47601ed04c11390cc53235a01 $ */
@@ -48,8 +54,10 @@
 
 #ifdef _MSC_VER
 #define ALIGNED(n) _declspec(align(n))
+#define TARGET(isa)
 #else
 #define ALIGNED(n) __attribute__((aligned(n)))
+#define TARGET(isa) __attribute__((target(isa)))
 #endif
 
 #define IS_PRINTABLE_ASCII(c) ((unsigned char)(c)-040u < 0137u)
@@ -104,10 +112,36 @@ static const char *token_char_map = "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\
                                     "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
                                     "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
 
-static const char *findchar_fast(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
+/* findchar kernels: return pointer to the first char within one of the ranges (pairs of inclusive bounds, up to 8 pairs),
+ * found is set to 0 when the kernel stops before buf_end without a match, the caller then continues scalar */
+typedef const char *(*findchar_t)(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found);
+
+static const char *findchar_ref(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
+{
+    *found = 0;
+    /* suppress unused parameter warning */
+    (void)buf_end;
+    (void)ranges;
+    (void)ranges_size;
+    return buf;
+}
+
+#ifdef PHR_X86
+static inline unsigned findchar_ctz(uint32_t v)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, v);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(v);
+#endif
+}
+
+TARGET("sse4.2")
+static const char *findchar_sse42(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
 {
     *found = 0;
-#if __SSE4_2__
     if (likely(buf_end - buf >= 16)) {
         __m128i ranges16 = _mm_loadu_si128((const __m128i *)ranges);
 
@@ -124,21 +158,175 @@ static const char *findchar_fast(const char *buf, const char *buf_end, const cha
             left -= 16;
         } while (likely(left != 0));
     }
-#else
-    /* suppress unused parameter warning */
-    (void)buf_end;
-    (void)ranges;
-    (void)ranges_size;
+    return buf;
+}
+
+/* c is in [lo, hi] when c - lo <= hi - lo (unsigned, modulo 256), min(x, d) == x tests x <= d */
+TARGET("avx2")
+static const char *findchar_avx2(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
+{
+    __m256i lo[8], d[8];
+    uint32_t n = ranges_size / 2, i;
+
+    *found = 0;
+    if (unlikely(buf_end - buf < 32))
+        return buf;
+
+    for (i = 0; i < n; i++) {
+        lo[i] = _mm256_set1_epi8(ranges[2 * i]);
+        d[i] = _mm256_set1_epi8((char)(ranges[2 * i + 1] - ranges[2 * i]));
+    }
+
+    uint32_t left = (buf_end - buf) & ~31;
+    do {
+        __m256i b32 = _mm256_loadu_si256((const __m256i *)buf);
+        __m256i m = _mm256_setzero_si256();
+        for (i = 0; i < n; i++) {
+            __m256i x = _mm256_sub_epi8(b32, lo[i]);
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(x, d[i]), x));
+        }
+        uint32_t r = (uint32_t)_mm256_movemask_epi8(m);
+        if (unlikely(r != 0)) {
+            buf += findchar_ctz(r);
+            *found = 1;
+            break;
+        }
+        buf += 32;
+        left -= 32;
+    } while (likely(left != 0));
+    return buf;
+}
 #endif
+
+#ifdef PHR_NEON
+/* same range test as avx2, the match mask is narrowed to 4 bits per byte */
+static const char *findchar_neon(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
+{
+    uint8x16_t lo[8], d[8];
+    uint32_t n = ranges_size / 2, i;
+
+    *found = 0;
+    if (unlikely(buf_end - buf < 16))
+        return buf;
+
+    for (i = 0; i < n; i++) {
+        lo[i] = vdupq_n_u8((uint8_t)ranges[2 * i]);
+        d[i] = vdupq_n_u8((uint8_t)(ranges[2 * i + 1] - ranges[2 * i]));
+    }
+
+    uint32_t left = (buf_end - buf) & ~15;
+    do {
+        uint8x16_t b16 = vld1q_u8((const uint8_t *)buf);
+        uint8x16_t m = vdupq_n_u8(0);
+        for (i = 0; i < n; i++)
+            m = vorrq_u8(m, vcleq_u8(vsubq_u8(b16, lo[i]), d[i]));
+        uint64_t r = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (unlikely(r != 0)) {
+            buf += __builtin_ctzll(r) >> 2;
+            *found = 1;
+            break;
+        }
+        buf += 16;
+        left -= 16;
+    } while (likely(left != 0));
     return buf;
 }
+#endif
+
+static const struct {
+    const char *name;
+    findchar_t fn;
+} findchar_kernels[] = { /* in order of preference when not timed, short tokens favour sse4.2 */
+#ifdef PHR_X86
+    {"sse4.2", findchar_sse42},
+    {"avx2", findchar_avx2},
+#endif
+#ifdef PHR_NEON
+    {"neon", findchar_neon},
+#endif
+    {"ref", findchar_ref},
+};
+
+static int findchar_supported(const char *name)
+{
+#ifdef PHR_X86
+#ifdef _MSC_VER
+    int r[4];
+    if (strcmp(name, "avx2") == 0) {
+        __cpuidex(r, 7, 0);
+        return (r[1] & (1 << 5)) != 0;
+    }
+    if (strcmp(name, "sse4.2") == 0) {
+        __cpuid(r, 1);
+        return (r[2] & (1 << 20)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2");
+    if (strcmp(name, "sse4.2") == 0)
+        return __builtin_cpu_supports("sse4.2");
+#endif
+#endif
+    (void)name;
+    return 1;
+}
+
+#define FINDCHAR_KERNELS (sizeof(findchar_kernels) / sizeof(findchar_kernels[0]))
+
+static const char *findchar_resolve(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found);
+
+static findchar_t findchar_fast = findchar_resolve;
+static const char *findchar_name = NULL;
+
+const char *phr_kernel(unsigned i)
+{
+    size_t k;
+
+    for (k = 0; k < FINDCHAR_KERNELS; k++) {
+        if (!findchar_supported(findchar_kernels[k].name))
+            continue;
+        if (i-- == 0)
+            return findchar_kernels[k].name;
+    }
+    return NULL;
+}
+
+const char *phr_select(const char *kernel)
+{
+    size_t k;
+
+    for (k = 0; k < FINDCHAR_KERNELS; k++) {
+        if (!findchar_supported(findchar_kernels[k].name))
+            continue;
+        if (kernel == NULL || strcmp(kernel, findchar_kernels[k].name) == 0) {
+            findchar_fast = findchar_kernels[k].fn;
+            findchar_name = findchar_kernels[k].name;
+            return findchar_name;
+        }
+    }
+    return NULL;
+}
+
+const char *phr_selected(void)
+{
+    return findchar_name;
+}
+
+/* the first call binds the first supported kernel unless one was selected */
+static const char *findchar_resolve(const char *buf, const char *buf_end, const char *ranges, uint32_t ranges_size, int *found)
+{
+    phr_select(NULL);
+    return findchar_fast(buf, buf_end, ranges, ranges_size, found);
+}
+
+#undef FINDCHAR_KERNELS
 
 static const char *get_token_to_eol(const char *buf, const char *buf_end, const char **token, uint32_t *token_len, int *ret)
 {
     const char *token_start = buf;
 
-#ifdef __SSE4_2__
-    static const char ranges1[] = "\0\010"
+    static const char ALIGNED(16) ranges1[] = "\0\010"
                                   /* allow HT */
                                   "\012\037"
                                   /* allow SP and up to but not including DEL */
@@ -149,8 +337,7 @@ static const char *get_token_to_eol(const char *buf, const char *buf_end, const
     buf = findchar_fast(buf, buf_end, ranges1, sizeof(ranges1) - 1, &found);
     if (found)
         goto FOUND_CTL;
-#else
-    /* find non-printable char within the next 8 bytes, this is the hottest code; manually inlined */
+    /* find non-printable char within the next 8 bytes (the tail after simd kernel), this is the hottest code; manually inlined */
     while (likely(buf_end - buf >= 8)) {
 #define DOIT()                                                                                                                     \
     do {                                                                                                                           \
@@ -174,7 +361,6 @@ static const char *get_token_to_eol(const char *buf, const char *buf_end, const
         }
         ++buf;
     }
-#endif
     for (;; ++buf) {
         CHECK_EOF();
         if (unlikely(!IS_PRINTABLE_ASCII(*buf))) {
@@ -631,6 +817,7 @@ int phr_decode_chunked_is_in_data(struct phr_chunked_decoder *decoder)
     return decoder->_state == CHUNKED_IN_CHUNK_DATA;
 }
 
+#undef TARGET
 #undef CHECK_EOF
 #undef EXPECT_CHAR
 #undef ADVANCE_TOKEN
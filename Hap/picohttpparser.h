@@ -83,6 +83,18 @@ suint32_t phr_decode_chunked(struct phr_chunked_decoder *decoder, char *buf, uin
 /* returns if the chunked decoder is in middle of chunked data */
 int phr_decode_chunked_is_in_data(struct phr_chunked_decoder *decoder);
 
+/* char search kernels ("avx2", "sse4.2", "neon", "ref"), the application may time them and bind the fastest one;
+ * the first supported kernel is bound on first parse if none was selected */
+
+/* returns name of i-th kernel supported by this CPU, NULL when i is out of range */
+const char *phr_kernel(unsigned i);
+
+/* binds the kernel, the first supported one if kernel is NULL, returns its name or NULL if it is not supported */
+const char *phr_select(const char *kernel);
+
+/* name of the bound char search kernel, NULL if none is bound yet */
+const char *phr_selected(void);
+
 #ifdef __cplusplus
 }
 #endif
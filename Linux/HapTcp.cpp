@@ -25,6 +25,7 @@ namespace Hap
 		bool running = false;
 
 		int server;
+		int wake[2];		// pipe signaled by crypto workers when a parked session can be resumed
 		int client[Hap::MaxHttpSessions + 1];
 		Hap::sid_t sess[Hap::MaxHttpSessions + 1];
 
@@ -51,12 +52,18 @@ namespace Hap
 				FD_SET(server, &readfds);
 				nfds = server + 1;
 
+				FD_SET(wake[0], &readfds);
+				if (wake[0] >= nfds)
+					nfds = wake[0] + 1;
+
 				for (unsigned i = 0; i < sizeofarr(client); i++)
 				{
 					int sd = client[i];
 					if (sd > 0)
 					{
-						FD_SET(sd, &readfds);
+						// parked session waits for crypto worker, its next request stays in socket
+						if (!_http->Parked(sess[i]))
+							FD_SET(sd, &readfds);
 						FD_SET(sd, &exceptfds);
 						if (sd >= nfds)
 							nfds = sd + 1;
@@ -101,6 +108,28 @@ namespace Hap
 					}
 				}
 
+				// crypto worker completed - resume parked sessions
+				//	a session which could not get buffers from the pool is retried on each pass
+				if (FD_ISSET(wake[0], &readfds))
+				{
+					char buf[16];
+					::read(wake[0], buf, sizeof(buf));
+				}
+
+				for (unsigned i = 0; i < sizeofarr(client); i++)
+				{
+					int sd = client[i];
+					if (sd == 0)
+						continue;
+
+					_http->Resume(sess[i], [sd](Hap::sid_t sid, char* buf, uint16_t len) -> int
+					{
+						if (buf != nullptr)
+							return ::send(sd, buf, len, 0);
+						return 0;
+					});
+				}
+
 				// read event on server socket - incoming connection
 				if (FD_ISSET(server, &readfds))
 				{
@@ -220,6 +249,7 @@ namespace Hap
 		TcpImpl()
 		{
 			server = 0;
+			wake[0] = wake[1] = -1;
 			for (unsigned i = 0; i < sizeofarr(client); i++)
 				client[i] = 0;
 		}
@@ -274,6 +304,20 @@ namespace Hap
 				return false;
 			}
 
+			// wake pipe, non-blocking so crypto workers never wait on it
+			if (::pipe(wake) < 0)
+			{
+				Log::Msg("pipe(wake) failed: %s\n", strerror(errno));
+				return false;
+			}
+			::fcntl(wake[0], F_SETFL, O_NONBLOCK);
+			::fcntl(wake[1], F_SETFL, O_NONBLOCK);
+
+			_http->Start([this]() -> void {
+				char c = 0;
+				::write(wake[1], &c, 1);
+			});
+
 			running = true;
 			task = std::thread(&TcpImpl::run, this);
 
@@ -288,6 +332,15 @@ namespace Hap
 
 			if (task.joinable())
 				task.join();
+
+			if (_http != nullptr)
+				_http->Stop();
+
+			if (wake[0] >= 0)
+				::close(wake[0]);
+			if (wake[1] >= 0)
+				::close(wake[1]);
+			wake[0] = wake[1] = -1;
 		}
 
 	} tcp;
@@ -11,10 +11,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/random.h>
 
 #include <string>
 #include <iostream>
 #include <chrono>
+#include <atomic>
 
 #include "Util/FileLog.h"
 
@@ -28,18 +32,48 @@ static inline uint16_t swap_16(uint16_t v)
 }
 
 // random number generator
+//	Crypto::rnd_data is a per-thread ChaCha20 generator (Crypto/Drbg.cpp),
+//	the platform provides its seed and fork notification
 namespace Crypto
 {
+	// number of forks, generators reseed when it changes
+	inline std::atomic<unsigned> rnd_fork_count{ 0 };
+
 	static inline void rnd_init()
 	{
-		srand((unsigned)time(NULL));
-		//srand(0);
+		// child process must not repeat parent's random sequence
+		pthread_atfork(nullptr, nullptr, []() { rnd_fork_count++; });
+	}
+
+	static inline unsigned rnd_forks()
+	{
+		return rnd_fork_count.load(std::memory_order_relaxed);
 	}
 
-	static inline void rnd_data(unsigned char* data, unsigned size)
+	// fill data from system entropy source
+	static inline void rnd_seed(unsigned char* data, unsigned size)
 	{
-		for (unsigned i = 0; i < size; i++)
-			*data++ = (uint8_t)(rand() & 0xFF);
+		while (size > 0)
+		{
+			ssize_t l = getrandom(data, size, 0);
+			if (l < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				// getrandom is not supported by the kernel
+				FILE* f = fopen("/dev/urandom", "rb");
+				if (f == nullptr || fread(data, 1, size, f) != size)
+				{
+					fprintf(stderr, "rnd_seed: no entropy source\n");
+					abort();
+				}
+				fclose(f);
+				return;
+			}
+			data += l;
+			size -= (unsigned)l;
+		}
 	}
 }
 
@@ -47,6 +81,7 @@ namespace Timer
 {
 	using Point = std::chrono::high_resolution_clock::time_point;
 	using DurMs = std::chrono::milliseconds::rep;
+	using DurUs = std::chrono::microseconds::rep;
 
 	static inline Point now()
 	{
@@ -57,6 +92,41 @@ namespace Timer
 	{
 		return std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
 	}
+
+	static inline DurUs us(Point t1, Point t2)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+	}
+
+	// current CPU clock in Hz, 0 if unknown
+	static inline uint64_t cpuHz()
+	{
+		unsigned long long khz = 0;
+		FILE* f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "r");
+		if (f != nullptr)
+		{
+			if (fscanf(f, "%llu", &khz) != 1)
+				khz = 0;
+			fclose(f);
+			if (khz != 0)
+				return khz * 1000;
+		}
+
+		// no cpufreq driver, use clock reported by the kernel
+		double mhz = 0;
+		f = fopen("/proc/cpuinfo", "r");
+		if (f != nullptr)
+		{
+			char line[128];
+			while (fgets(line, sizeof(line), f) != nullptr)
+			{
+				if (sscanf(line, "cpu MHz : %lf", &mhz) == 1)
+					break;
+			}
+			fclose(f);
+		}
+		return uint64_t(mhz * 1000000);
+	}
 }
 
 
@@ -648,14 +648,20 @@ Hap::File::Config<MyDbType> myConfig(&db, &configDef, CONFIG_NAME);
 Hap::Config* Hap::config = &myConfig;
 
 // statically allocated storage for HTTP processing
-//	Our implementation is single-threaded so only one set of buffers.
-//	The http server uses this buffers only during processing a request.
+//	The http server takes request, response and temp buffers from the pool for each request
+//	and returns them when the request is done. Our implementation is single-threaded,
+//	so the pool holds buffers of one request, plus a bigger request buffer for large requests
+//	and a request buffer for each session, which keeps it while it has pipelined data.
 //	All session-persistent data is kept in Session objects.
-Hap::BufStatic<char, Hap::MaxHttpFrame * 2> http_req;
-Hap::BufStatic<char, Hap::MaxHttpFrame * 4> http_rsp;
-Hap::BufStatic<char, Hap::MaxHttpFrame * 1> http_tmp;
-Hap::Http::Server::Buf buf{ http_req, http_rsp, http_tmp };
-Hap::Http::Server http(buf, db, myConfig.pairings, myConfig.keys);
+static char http_small[Hap::MaxHttpSessions + 1][Hap::Http::Server::ReqSize];	// request and temp buffers
+static char http_medium[1][Hap::MaxHttpFrame * 2];			// request buffer of large request
+static char http_large[1][Hap::Http::Server::RspSize];		// response buffer
+Hap::BufPool pool{
+	{ http_small[0], sizeof(http_small[0]), sizeofarr(http_small) },
+	{ http_medium[0], sizeof(http_medium[0]), sizeofarr(http_medium) },
+	{ http_large[0], sizeof(http_large[0]), sizeofarr(http_large) },
+};
+Hap::Http::Server http(pool, db, myConfig.pairings, myConfig.keys);
 
 int hapServer(int argc, char* argv[])
 {
@@ -716,6 +722,9 @@ int hapServer(int argc, char* argv[])
 		// restore configuration
 		myConfig.Init(reset);
 
+		// bind fastest crypto kernels, config may force some of them
+		Crypto::select(myConfig.crypto);
+
 		// set config update callback
 		myConfig.Update = [mdns]() -> void {
 
@@ -799,6 +808,14 @@ int main(int argc, char* argv[])
 	return cryptoTest();
 #endif
 
+#ifdef CRYPTO_BENCH
+	return cryptoBench(argc > 1 ? argv[1] : nullptr);
+#endif
+
+#ifdef DB_BENCH
+	return dbBench(argc > 1 ? argv[1] : nullptr);
+#endif
+
 #ifdef JOY_TEST
 	Joystick* js = nullptr;
 
@@ -178,6 +178,8 @@ public:
 		firmwareRevision = _firmwareRevision;
 		deviceId = _deviceId;
 		setupCode = _setupCode;
+		crypto = _crypto;
+		_crypto[0] = 0;
 	}
 
 private:
@@ -192,6 +194,7 @@ private:
 	char _firmwareRevision[Hap::DefString];	// Major[.Minor[.Revision]]
 	char _deviceId[Hap::DefString];			// Device ID (XX:XX:XX:XX:XX:XX, new deviceId generated on each factory reset)
 	char _setupCode[Hap::DefString];			// setupCode code XXX-XX-XXX
+	char _crypto[Hap::DefString];				// crypto kernels override
 
 	virtual void _default() override
 	{
@@ -218,9 +221,11 @@ private:
 			;
 
 		strcpy(_setupCode, _def->setupCode);
+		_srp();
 
 		port = swap_16(_def->tcpPort);
 		BCT = 0;
+		_crypto[0] = 0;
 
 		pairings.Reset();
 		keys.Reset();
@@ -240,10 +245,39 @@ private:
 		configNum++;
 		statusFlags = Hap::Bonjour::NotPaired;
 
+		_srp();
+
 		pairings.Reset();
 		keys.Reset();
 	}
 
+	// save SRP salt, verifier and setupCode check as ["salt","verifier","check"]
+	//	invalid verifier is not saved, it is generated again on next restore
+	void _saveSrp(FILE* f)
+	{
+		if (!srpValid)
+			return;
+
+		char* s = new char[sizeof(srpVerifier) * 2 + 1];
+		uint8_t check[SrpCheckBytes];
+
+		fprintf(f, "\t\"%s\":[\n", key[key_srp]);
+
+		bin2hex(srpSalt, sizeof(srpSalt), s);
+		fprintf(f, "\t\t \"%s\"\n", s);
+
+		bin2hex(srpVerifier, sizeof(srpVerifier), s);
+		fprintf(f, "\t\t,\"%s\"\n", s);
+
+		_srpCheck(check);
+		bin2hex(check, sizeof(check), s);
+		fprintf(f, "\t\t,\"%s\"\n", s);
+
+		fprintf(f, "\t],\n");
+
+		delete[] s;
+	}
+
 	virtual bool _save() override
 	{
 		FILE* f = fopen(_fileName, "w+b");
@@ -266,7 +300,9 @@ private:
 		fprintf(f, "\t\"%s\":\"%d\",\n", key[key_category], categoryId);
 		fprintf(f, "\t\"%s\":\"%d\",\n", key[key_status], statusFlags);
 		fprintf(f, "\t\"%s\":\"%s\",\n", key[key_setup], setupCode);
+		_saveSrp(f);
 		fprintf(f, "\t\"%s\":\"%d\",\n", key[key_port], swap_16(port));
+		fprintf(f, "\t\"%s\":\"%s\",\n", key[key_crypto], crypto);
 
 		fprintf(f, "\t\"%s\":[\n", key[key_keys]);
 		keys.Save(f);
@@ -308,12 +344,16 @@ private:
 			{ key[key_category], Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_status], Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_setup], Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
+			{ key[key_srp], Hap::Json::JSMN_ARRAY | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_port], Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
+			{ key[key_crypto], Hap::Json::JSMN_STRING | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_keys], Hap::Json::JSMN_ARRAY | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_pairings], Hap::Json::JSMN_ARRAY | Hap::Json::JSMN_UNDEFINED },
 			{ key[key_db], Hap::Json::JSMN_OBJECT | Hap::Json::JSMN_UNDEFINED },
 		};
 		bool ret = false;
+		bool srp = false;
+		uint8_t srpCheck[SrpCheckBytes];
 		char* b = nullptr;
 		long size = 0;
 		Hap::Json::ParserStatic<100> js;	// allocates parser on stack, TODO? 
@@ -332,7 +372,7 @@ private:
 		if (fread(b, 1, size, f) != size_t(size))
 			goto Ret;
 
-		if (!js.parse(b, (uint16_t)size))
+		if (!js.parse(b, (uint32_t)size))
 			goto Ret;
 
 		if (js.tk(0)->type != Hap::Json::JSMN_OBJECT)
@@ -397,11 +437,33 @@ private:
 				js.copy(i, _setupCode, sizeof(_setupCode));
 				Log::Msg("Config: restore setupCode '%s'\n", setupCode);
 				break;
+			case key_srp:
+				// srp array must contain salt, verifier and setupCode check
+				if (js.size(i) == 3)
+				{
+					int s = js.find(i, 0);
+					int v = js.find(i, 1);
+					int c = js.find(i, 2);
+					if (js.length(s) == sizeof(srpSalt) * 2 && js.length(v) == sizeof(srpVerifier) * 2
+						&& js.length(c) == sizeof(srpCheck) * 2)
+					{
+						hex2bin(js.start(s), srpSalt, sizeof(srpSalt));
+						hex2bin(js.start(v), srpVerifier, sizeof(srpVerifier));
+						hex2bin(js.start(c), srpCheck, sizeof(srpCheck));
+						Log::Msg("Config: restore srp '%.*s'\n", js.length(s), js.start(s));
+						srp = true;
+					}
+				}
+				break;
 			case key_port:
 				js.set_if(i, port);
 				Log::Msg("Config: restore port '%d'\n", port);
 				port = swap_16(port);
 				break;
+			case key_crypto:
+				js.copy(i, _crypto, sizeof(_crypto));
+				Log::Msg("Config: restore crypto '%s'\n", crypto);
+				break;
 			case key_keys:
 				// keys array must contain exactly two members
 				if (js.size(i) == 2)
@@ -442,6 +504,24 @@ private:
 			}
 		}
 
+		// restored verifier must be generated for restored setupCode
+		if (srp)
+		{
+			uint8_t check[SrpCheckBytes];
+			_srpCheck(check);
+			if (memcmp(check, srpCheck, sizeof(check)) != 0)
+			{
+				Log::Msg("Config: setupCode changed, srp is not valid\n");
+				srp = false;
+			}
+		}
+
+		// generate salt and verifier if they are missing, setupCode is already restored
+		if (srp)
+			srpValid = true;
+		else
+			_srp();
+
 		ret = true;
 
 	Ret:
@@ -7,11 +7,13 @@
 #define _PLATFORM_H_
 
 #define _CRT_SECURE_NO_WARNINGS
+#define _CRT_RAND_S		// rand_s - system entropy source
 
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <string>
 #include <iostream>
@@ -30,18 +32,37 @@ static inline uint16_t swap_16(uint16_t v)
 }
 
 // random number generator
+//	Crypto::rnd_data is a per-thread ChaCha20 generator (Crypto/Drbg.cpp),
+//	the platform provides its seed and fork notification
 namespace Crypto
 {
 	static inline void rnd_init()
 	{
-		//srand((unsigned)time(NULL));
-		srand(0);
 	}
 
-	static inline void rnd_data(unsigned char* data, unsigned size)
+	// no fork on Windows
+	static inline unsigned rnd_forks()
 	{
-		for (unsigned i = 0; i < size; i++)
-			*data++ = rand() & 0xFF;
+		return 0;
+	}
+
+	// fill data from system entropy source
+	static inline void rnd_seed(unsigned char* data, unsigned size)
+	{
+		while (size > 0)
+		{
+			unsigned int v;
+			if (rand_s(&v) != 0)
+			{
+				fprintf(stderr, "rnd_seed: no entropy source\n");
+				abort();
+			}
+
+			unsigned l = size < sizeof(v) ? size : sizeof(v);
+			memcpy(data, &v, l);
+			data += l;
+			size -= l;
+		}
 	}
 }
 
@@ -49,6 +70,7 @@ namespace Timer
 {
 	using Point = std::chrono::high_resolution_clock::time_point;
 	using DurMs = std::chrono::milliseconds::rep;
+	using DurUs = std::chrono::microseconds::rep;
 
 	static inline Point now()
 	{
@@ -59,6 +81,17 @@ namespace Timer
 	{
 		return std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
 	}
+
+	static inline DurUs us(Point t1, Point t2)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+	}
+
+	// current CPU clock in Hz, 0 if unknown
+	static inline uint64_t cpuHz()
+	{
+		return 0;
+	}
 }
 
 
@@ -368,18 +368,20 @@ Hap::File::Config myConfig{ &db, &configDef, CONFIG_NAME };
 Hap::Config* Hap::config{ &myConfig };
 
 // statically allocated storage for HTTP processing
-//	Our implementation is single-threaded hence the only one set of buffers.
-//	The http server uses this buffers only during processing a request.
+//	The http server takes request, response and temp buffers from the pool for each request
+//	and returns them when the request is done. Our implementation is single-threaded,
+//	so the pool holds buffers of one request, plus a bigger request buffer for large requests
+//	and a request buffer for each session, which keeps it while it has pipelined data.
 //	All session-persistent data is kept in Session objects.
-char http_req_buf[Hap::MaxHttpFrame * 2];
-char http_rsp_buf[Hap::MaxHttpFrame * 4];
-char http_tmp_buf[Hap::MaxHttpFrame * 1];
-static Hap::Buf http_req(http_req_buf, sizeof(http_req_buf));
-static Hap::Buf http_rsp(http_rsp_buf, sizeof(http_rsp_buf));
-static Hap::Buf http_tmp(http_tmp_buf, sizeof(http_tmp_buf));
-static Hap::Http::Server::Buf http_buf{ http_req, http_rsp, http_tmp };
-
-Hap::Http::Server http(http_buf, db, myConfig.pairings, myConfig.keys);
+static char http_small[Hap::MaxHttpSessions + 1][Hap::Http::Server::ReqSize];	// request and temp buffers
+static char http_medium[1][Hap::MaxHttpFrame * 2];			// request buffer of large request
+static char http_large[1][Hap::Http::Server::RspSize];		// response buffer
+Hap::BufPool pool{
+	{ http_small[0], sizeof(http_small[0]), sizeofarr(http_small) },
+	{ http_medium[0], sizeof(http_medium[0]), sizeofarr(http_medium) },
+	{ http_large[0], sizeof(http_large[0]), sizeofarr(http_large) },
+};
+Hap::Http::Server http(pool, db, myConfig.pairings, myConfig.keys);
 
 static int hapTest()
 {
@@ -398,6 +400,9 @@ static int hapTest()
 	// restore configuration
 	myConfig.Init();
 
+	// bind fastest crypto kernels, config may force some of them
+	Crypto::select(myConfig.crypto);
+
 	// set config update callback
 	myConfig.Update = [mdns]() -> void {
 
@@ -483,6 +488,10 @@ int main()
 
 //	r += cryptoTest();
 
+//	r += cryptoBench("CryptoBench.json");
+
+//	r += dbBench("DbBench.json");
+
 	r += hapTest();
 
 //	ktest();
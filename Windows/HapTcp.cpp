@@ -23,6 +23,8 @@ namespace Hap
 		bool running = false;
 
 		SOCKET server;
+		SOCKET wake;				// loopback UDP socket signaled by crypto workers when a parked session can be resumed
+		sockaddr_in wakeAddr;
 		SOCKET client[Hap::MaxHttpSessions + 1];
 		Hap::sid_t sess[Hap::MaxHttpSessions + 1];
 
@@ -39,11 +41,14 @@ namespace Hap
 				FD_ZERO(&readfds);
 
 				FD_SET(server, &readfds);
+				FD_SET(wake, &readfds);
 
 				for (int i = 0; i < sizeofarr(client); i++)
 				{
 					SOCKET sd = client[i];
-					if (sd > 0)
+
+					// parked session waits for crypto worker, its next request stays in socket
+					if (sd > 0 && !_http->Parked(sess[i]))
 						FD_SET(sd, &readfds);
 				}
 
@@ -76,6 +81,28 @@ namespace Hap
 					}
 				}
 
+				// crypto worker completed - resume parked sessions
+				//	a session which could not get buffers from the pool is retried on each pass
+				if (FD_ISSET(wake, &readfds))
+				{
+					char buf[16];
+					recv(wake, buf, sizeof(buf), 0);
+				}
+
+				for (int i = 0; i < sizeofarr(client); i++)
+				{
+					SOCKET sd = client[i];
+					if (sd == 0)
+						continue;
+
+					_http->Resume(sess[i], [sd](Hap::sid_t sid, char* buf, uint16_t len) -> int
+					{
+						if (buf != nullptr)
+							return send(sd, buf, len, 0);
+						return 0;
+					});
+				}
+
 				// read event on server socket - incoming connection
 				if (FD_ISSET(server, &readfds))
 				{
@@ -210,6 +237,7 @@ namespace Hap
 		{
 			WSADATA wsaData = { 0 };
 			WSAStartup(MAKEWORD(2, 2), &wsaData);
+			wake = INVALID_SOCKET;
 		}
 
 		~TcpImpl()
@@ -259,6 +287,30 @@ namespace Hap
 				return false;
 			}
 
+			// wake socket bound to loopback on any free port
+			wake = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (wake == INVALID_SOCKET)
+			{
+				Log::Msg("wake socket creation failed");
+				return false;
+			}
+
+			int wakeLen = sizeof(wakeAddr);
+			wakeAddr.sin_family = AF_INET;
+			wakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			wakeAddr.sin_port = 0;
+			if (bind(wake, (struct sockaddr *)&wakeAddr, sizeof(wakeAddr)) < 0 ||
+				getsockname(wake, (struct sockaddr *)&wakeAddr, &wakeLen) < 0)
+			{
+				Log::Msg("bind(wake, INADDR_LOOPBACK) failed");
+				return false;
+			}
+
+			_http->Start([this]() -> void {
+				char c = 0;
+				sendto(wake, &c, 1, 0, (struct sockaddr *)&wakeAddr, sizeof(wakeAddr));
+			});
+
 			running = true;
 			task = std::thread(&TcpImpl::run, this);
 
@@ -274,6 +326,13 @@ namespace Hap
 
 			if (task.joinable())
 				task.join();
+
+			if (_http != nullptr)
+				_http->Stop();
+
+			if (wake != INVALID_SOCKET)
+				closesocket(wake);
+			wake = INVALID_SOCKET;
 		}
 
 	} tcp;